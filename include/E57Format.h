@@ -96,6 +96,9 @@ const ReadChecksumPolicy CHECKSUM_POLICY_SPARSE = 25; //! Only verify 25% of the
 const ReadChecksumPolicy CHECKSUM_POLICY_HALF = 50;   //! Only verify 50% of the checksums. The last block is always verified.
 const ReadChecksumPolicy CHECKSUM_POLICY_ALL = 100;   //! Verify all checksums. This is the default. (slow)
 
+//! @brief Use this many threads to verify checksums of large reads (1, the default, means only the reading thread).
+void setChecksumThreadCount(unsigned threadCount);
+
 //! @brief The major version number of the Foundation API
 const int E57_FOUNDATION_API_MAJOR = 0;
 
@@ -165,6 +168,8 @@ class IntegerNode;
 class IntegerNodeImpl;
 class Node;
 class NodeImpl;
+class PointBlock;
+class PointBlockImpl;
 class ScaledIntegerNode;
 class ScaledIntegerNodeImpl;
 class SourceDestBuffer;
@@ -328,6 +333,34 @@ private:
 //! \endcond
 };
 
+class PointBlock
+{
+public:
+    PointBlock() = delete;
+    PointBlock(ImageFile destImageFile, size_t capacity);
+    PointBlock(const CompressedVectorNode& cv, size_t capacity);
+
+    size_t          addColumn(const ustring& pathName, MemoryRepresentation representation,
+                              bool doConversion = false, bool doScaling = false);
+
+    size_t          capacity() const;
+    size_t          columnCount() const;
+    size_t          columnIndex(const ustring& pathName) const;
+    ustring         columnPathName(size_t index) const;
+    enum MemoryRepresentation  columnRepresentation(size_t index) const;
+    void*           columnData(size_t index) const;
+    std::vector<ustring>* columnStrings(size_t index) const;
+
+    // Diagnostic functions:
+    void            dump(int indent = 0, std::ostream& os = std::cout) const;
+    void            checkInvariant(bool doRecurse = true) const;
+
+//! \cond documentNonPublic   The following isn't part of the API, and isn't documented.
+private:
+    E57_OBJECT_IMPLEMENTATION(PointBlock)  // Internal implementation details, not part of API, must be last in object
+//! \endcond
+};
+
 class CompressedVectorReader
 {
 public:
@@ -335,7 +368,7 @@ public:
 
     unsigned    read();
     unsigned    read(std::vector<SourceDestBuffer>& dbufs);
-    void        seek(int64_t recordNumber); // !!! not implemented yet
+    void        seek(int64_t recordNumber);
     void        close();
     bool        isOpen();
     CompressedVectorNode compressedVectorNode() const;
@@ -390,6 +423,8 @@ public:
     // Iterators
     CompressedVectorWriter writer(std::vector<SourceDestBuffer>& sbufs);
     CompressedVectorReader reader(const std::vector<SourceDestBuffer>& dbufs);
+    CompressedVectorWriter writer(PointBlock& block);
+    CompressedVectorReader reader(const PointBlock& block);
 
     // Up/Down cast conversion
                 operator Node() const;
@@ -623,6 +658,20 @@ public:
     int             writerCount() const;
     int             readerCount() const;
 
+    // Tune memory used by readers
+    void            setPacketCacheSize(unsigned packetCount);
+    unsigned        packetCacheSize() const;
+    void            setPacketPrefetchCount(unsigned packetCount);
+    unsigned        packetPrefetchCount() const;
+
+    // Tune threads used by writers and readers
+    void            setCodecThreadCount(unsigned threadCount);
+    unsigned        codecThreadCount() const;
+
+    // Choose whether writers index their data for seeking
+    void            setIndexPacketsEnabled(bool enable);
+    bool            indexPacketsEnabled() const;
+
     // Manipulate registered extensions in the file
     void            extensionsAdd(const ustring& prefix, const ustring& uri);
     bool            extensionsLookupPrefix(const ustring& prefix, ustring& uri) const;
@@ -654,6 +703,7 @@ private:
     friend class FloatNode;
     friend class StringNode;
     friend class BlobNode;
+    friend class PointBlockImpl;
 
                     ImageFile(std::shared_ptr<ImageFileImpl> imfi);  // internal use only
 
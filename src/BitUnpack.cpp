@@ -0,0 +1,596 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define E57_UNPACK_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define E57_TARGET_SSE41
+#define E57_TARGET_AVX2
+#else
+#define E57_TARGET_SSE41   __attribute__((target("sse4.1")))
+#define E57_TARGET_AVX2    __attribute__((target("avx2")))
+#endif
+#endif
+
+#include "BitUnpack.h"
+
+using namespace e57;
+
+namespace
+{
+   /// Kernels unpack whole groups of 8 values and return how many values they did, the scalar loop finishes the rest.
+   /// A group of 8 values is exactly bitsPerValue bytes long, so every group starts at the same bit within its first byte.
+   using UnpackFunction = size_t (*)(const uint8_t* in, size_t firstBit, unsigned bitsPerValue, size_t count, uint32_t* out);
+
+   /// Widest value that, shifted by up to 7 bits within its first byte, still fits a 32 bit lane
+   constexpr unsigned maxKernelBits = 25;
+
+   size_t unpackNone(const uint8_t*, size_t, unsigned, size_t, uint32_t*)
+   {
+      return 0;
+   }
+
+   void unpackScalar(const uint8_t* in, size_t firstBit, unsigned bitsPerValue, size_t count, uint32_t* out)
+   {
+      const size_t byteCount = (firstBit + count*bitsPerValue + 7) / 8;
+      const uint64_t mask = (1ULL << bitsPerValue) - 1;
+
+      size_t bitPosition = firstBit;
+      for (size_t i = 0; i < count; i++, bitPosition += bitsPerValue)
+      {
+         const size_t byte = bitPosition / 8;
+         const unsigned shift = bitPosition % 8;
+
+         /// Value spans at most 5 bytes.  Take a whole word when that stays inside the stream.
+         uint64_t w = 0;
+         if (byte + sizeof(w) <= byteCount)
+         {
+            memcpy(&w, in + byte, sizeof(w));
+         }
+         else
+         {
+            const size_t nBytes = (shift + bitsPerValue + 7) / 8;
+            for (size_t k = 0; k < nBytes; k++)
+            {
+               w |= static_cast<uint64_t>(in[byte + k]) << (8*k);
+            }
+         }
+
+         out[i] = static_cast<uint32_t>((w >> shift) & mask);
+      }
+   }
+
+#ifdef E57_UNPACK_X86
+   /// Where each of the 8 values of a group sits.  Lanes 0-3 are gathered from 16 bytes loaded at the start of the
+   /// group, lanes 4-7 from 16 bytes loaded at upperByte, each lane takes the 4 bytes starting at the value's first byte.
+   struct GroupLayout
+   {
+      alignas(32) uint8_t   shuffle[32];
+      alignas(32) uint32_t  shift[8];
+      size_t                upperByte;
+
+      GroupLayout(unsigned startBit, unsigned bitsPerValue)
+      {
+         upperByte = (startBit + 4*bitsPerValue) / 8;
+
+         for (unsigned lane = 0; lane < 8; lane++)
+         {
+            const unsigned bitPosition = startBit + lane*bitsPerValue;
+            const unsigned byte = bitPosition / 8 - ((lane < 4) ? 0 : static_cast<unsigned>(upperByte));
+
+            for (unsigned k = 0; k < 4; k++)
+            {
+               shuffle[4*lane + k] = static_cast<uint8_t>(byte + k);
+            }
+            shift[lane] = bitPosition % 8;
+         }
+      }
+
+      /// Both 16 byte loads of group must be inside the byteCount long stream
+      size_t groupCount(size_t count, unsigned bitsPerValue, size_t byteCount) const
+      {
+         const size_t lastLoadEnd = upperByte + 16;
+         if (byteCount < lastLoadEnd)
+         {
+            return 0;
+         }
+         return std::min(count / 8, (byteCount - lastLoadEnd) / bitsPerValue + 1);
+      }
+   };
+
+   E57_TARGET_SSE41 size_t unpackSse41(const uint8_t* in, size_t firstBit, unsigned bitsPerValue, size_t count, uint32_t* out)
+   {
+      const uint8_t* p = in + firstBit / 8;
+      const GroupLayout layout(firstBit % 8, bitsPerValue);
+      const size_t groups = layout.groupCount(count, bitsPerValue, (firstBit % 8 + count*bitsPerValue + 7) / 8);
+
+      /// No variable shift in SSE4.1: multiply each lane up so its value starts at bit 7, then shift all by 7
+      const __m128i shuffleLo = _mm_load_si128(reinterpret_cast<const __m128i*>(layout.shuffle));
+      const __m128i shuffleHi = _mm_load_si128(reinterpret_cast<const __m128i*>(layout.shuffle + 16));
+      const __m128i multiplyLo = _mm_setr_epi32(1 << (7 - layout.shift[0]), 1 << (7 - layout.shift[1]),
+                                                1 << (7 - layout.shift[2]), 1 << (7 - layout.shift[3]));
+      const __m128i multiplyHi = _mm_setr_epi32(1 << (7 - layout.shift[4]), 1 << (7 - layout.shift[5]),
+                                                1 << (7 - layout.shift[6]), 1 << (7 - layout.shift[7]));
+      const __m128i mask = _mm_set1_epi32(static_cast<int>((1U << bitsPerValue) - 1));
+
+      for (size_t g = 0; g < groups; g++, p += bitsPerValue, out += 8)
+      {
+         __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+         __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + layout.upperByte));
+
+         lo = _mm_and_si128(_mm_srli_epi32(_mm_mullo_epi32(_mm_shuffle_epi8(lo, shuffleLo), multiplyLo), 7), mask);
+         hi = _mm_and_si128(_mm_srli_epi32(_mm_mullo_epi32(_mm_shuffle_epi8(hi, shuffleHi), multiplyHi), 7), mask);
+
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), hi);
+      }
+
+      return 8*groups;
+   }
+
+   E57_TARGET_AVX2 size_t unpackAvx2(const uint8_t* in, size_t firstBit, unsigned bitsPerValue, size_t count, uint32_t* out)
+   {
+      const uint8_t* p = in + firstBit / 8;
+      const GroupLayout layout(firstBit % 8, bitsPerValue);
+      const size_t groups = layout.groupCount(count, bitsPerValue, (firstBit % 8 + count*bitsPerValue + 7) / 8);
+
+      /// The byte shuffle works within each 128 bit half, which is why the halves are loaded separately
+      const __m256i shuffle = _mm256_load_si256(reinterpret_cast<const __m256i*>(layout.shuffle));
+      const __m256i shift = _mm256_load_si256(reinterpret_cast<const __m256i*>(layout.shift));
+      const __m256i mask = _mm256_set1_epi32(static_cast<int>((1U << bitsPerValue) - 1));
+
+      for (size_t g = 0; g < groups; g++, p += bitsPerValue, out += 8)
+      {
+         const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+         const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + layout.upperByte));
+
+         __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+         v = _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(v, shuffle), shift), mask);
+
+         _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+      }
+
+      return 8*groups;
+   }
+#endif
+
+   /// Instruction set extensions of the CPU, found once
+   struct CpuFeatures
+   {
+      bool  hasSse41 = false;
+      bool  hasAvx2 = false;
+
+      CpuFeatures()
+      {
+#ifdef E57_UNPACK_X86
+#if defined(_MSC_VER)
+         int info[4] = {};
+         __cpuid(info, 1);
+         hasSse41 = (info[2] & (1 << 19)) != 0;
+         const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+         __cpuidex(info, 7, 0);
+         hasAvx2 = osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+         /// Also checks that the OS saves the AVX registers
+         hasSse41 = __builtin_cpu_supports("sse4.1");
+         hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+#endif
+      }
+   };
+
+   const CpuFeatures& cpuFeatures()
+   {
+      static const CpuFeatures features;
+      return features;
+   }
+
+   UnpackFunction selectUnpackFunction()
+   {
+#ifdef E57_UNPACK_X86
+      if (cpuFeatures().hasAvx2)
+      {
+         return unpackAvx2;
+      }
+
+      if (cpuFeatures().hasSse41)
+      {
+         return unpackSse41;
+      }
+#endif
+
+      return unpackNone;
+   }
+
+   /// Scaling kernels do groups of 4 values and return how many they did, the scalar loop finishes the rest.
+   /// bias is minimum as a double, which the caller has made sure is exact.
+   template <typename T>
+   using ScaleFunction = size_t (*)(const uint32_t* raw, size_t count, double bias, double scale, double offset, T* out);
+
+   template <typename T>
+   size_t scaleNone(const uint32_t*, size_t, double, double, double, T*)
+   {
+      return 0;
+   }
+
+   /// Same operations in the same order as SourceDestBufferImpl::setNextInt64(value, scale, offset).
+   /// minimum + raw is exact in double, so adding in double gives the same value as converting the int64 sum.
+   template <typename T>
+   void scaleScalar(const uint32_t* raw, size_t count, double bias, double scale, double offset, T* out)
+   {
+      for (size_t i = 0; i < count; i++)
+      {
+         const double scaledValue = (static_cast<double>(raw[i]) + bias)*scale + offset;
+         out[i] = static_cast<T>(scaledValue);
+      }
+   }
+
+#ifdef E57_UNPACK_X86
+   /// Four raw values converted, biased, scaled and offset.  There is only a signed conversion, so flip the top bit
+   /// first and fold the 2^31 it takes off into the bias.  Separate multiply and add, no fused rounding.
+   E57_TARGET_AVX2 inline __m256d scaleLanes(const uint32_t* raw, __m256d bias, __m256d scale, __m256d offset)
+   {
+      const __m128i flipped = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(raw)),
+                                            _mm_set1_epi32(static_cast<int>(0x80000000U)));
+      const __m256d value = _mm256_add_pd(_mm256_cvtepi32_pd(flipped), bias);
+      return _mm256_add_pd(_mm256_mul_pd(value, scale), offset);
+   }
+
+   E57_TARGET_AVX2 size_t scaleAvx2(const uint32_t* raw, size_t count, double bias, double scale, double offset, double* out)
+   {
+      const __m256d biasVec = _mm256_set1_pd(bias + 2147483648.0);
+      const __m256d scaleVec = _mm256_set1_pd(scale);
+      const __m256d offsetVec = _mm256_set1_pd(offset);
+
+      const size_t done = count & ~static_cast<size_t>(3);
+      for (size_t i = 0; i < done; i += 4)
+      {
+         _mm256_storeu_pd(out + i, scaleLanes(raw + i, biasVec, scaleVec, offsetVec));
+      }
+
+      return done;
+   }
+
+   E57_TARGET_AVX2 size_t scaleAvx2(const uint32_t* raw, size_t count, double bias, double scale, double offset, float* out)
+   {
+      const __m256d biasVec = _mm256_set1_pd(bias + 2147483648.0);
+      const __m256d scaleVec = _mm256_set1_pd(scale);
+      const __m256d offsetVec = _mm256_set1_pd(offset);
+
+      const size_t done = count & ~static_cast<size_t>(3);
+      for (size_t i = 0; i < done; i += 4)
+      {
+         _mm_storeu_ps(out + i, _mm256_cvtpd_ps(scaleLanes(raw + i, biasVec, scaleVec, offsetVec)));
+      }
+
+      return done;
+   }
+#endif
+
+   template <typename T>
+   ScaleFunction<T> selectScaleFunction()
+   {
+#ifdef E57_UNPACK_X86
+      if (cpuFeatures().hasAvx2)
+      {
+         return scaleAvx2;
+      }
+#endif
+
+      return scaleNone<T>;
+   }
+
+   template <typename T>
+   void scaleValues(const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset, T* out)
+   {
+      static const ScaleFunction<T> scaleFunction = selectScaleFunction<T>();
+
+      const double bias = static_cast<double>(minimum);
+
+      const size_t done = scaleFunction(raw, count, bias, scale, offset, out);
+      scaleScalar(raw + done, count - done, bias, scale, offset, out + done);
+   }
+
+   /// Range check kernels do groups of 4 values and return how many they did, the scalar loop finishes the rest.
+   /// inRange is cleared if any value done is outside [minimum, maximum], and left alone otherwise.
+   using SubtractFunction = size_t (*)(const int64_t* values, size_t count, int64_t minimum, int64_t maximum, uint32_t* out, bool& inRange);
+
+   size_t subtractNone(const int64_t*, size_t, int64_t, int64_t, uint32_t*, bool&)
+   {
+      return 0;
+   }
+
+   /// Subtract as unsigned, so values out of range wrap instead of overflowing
+   void subtractScalar(const int64_t* values, size_t count, int64_t minimum, int64_t maximum, uint32_t* out, bool& inRange)
+   {
+      bool allInRange = true;
+      for (size_t i = 0; i < count; i++)
+      {
+         allInRange &= (minimum <= values[i] && values[i] <= maximum);
+         out[i] = static_cast<uint32_t>(static_cast<uint64_t>(values[i]) - static_cast<uint64_t>(minimum));
+      }
+
+      inRange &= allInRange;
+   }
+
+#ifdef E57_UNPACK_X86
+   E57_TARGET_AVX2 size_t subtractAvx2(const int64_t* values, size_t count, int64_t minimum, int64_t maximum, uint32_t* out, bool& inRange)
+   {
+      const __m256i minimumVec = _mm256_set1_epi64x(minimum);
+      const __m256i maximumVec = _mm256_set1_epi64x(maximum);
+
+      /// Moves the low halves of the four 64 bit differences to the bottom 128 bits
+      const __m256i lowHalves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+      __m256i outside = _mm256_setzero_si256();
+
+      const size_t done = count & ~static_cast<size_t>(3);
+      for (size_t i = 0; i < done; i += 4)
+      {
+         const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+         outside = _mm256_or_si256(outside, _mm256_or_si256(_mm256_cmpgt_epi64(minimumVec, v), _mm256_cmpgt_epi64(v, maximumVec)));
+
+         const __m256i difference = _mm256_permutevar8x32_epi32(_mm256_sub_epi64(v, minimumVec), lowHalves);
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(difference));
+      }
+
+      if (!_mm256_testz_si256(outside, outside))
+      {
+         inRange = false;
+      }
+
+      return done;
+   }
+#endif
+
+   SubtractFunction selectSubtractFunction()
+   {
+#ifdef E57_UNPACK_X86
+      if (cpuFeatures().hasAvx2)
+      {
+         return subtractAvx2;
+      }
+#endif
+
+      return subtractNone;
+   }
+
+   /// Appends bit fields to a little endian bitstream.  Holds the bits of the last, incomplete byte until finish().
+   struct BitWriter
+   {
+      uint8_t*    p;             // byte the pending bits go to
+      uint64_t    pending;
+      unsigned    pendingBits;   // always less than 8 between calls
+
+      /// Starts at bit firstBit of p[0], keeping the bits below it
+      BitWriter(uint8_t* start, unsigned firstBit)
+         : p(start), pending(0), pendingBits(firstBit)
+      {
+         if (firstBit > 0)
+         {
+            pending = p[0] & ((1U << firstBit) - 1);
+         }
+      }
+
+      /// Add n bits, n at most 56, with one 8 byte store.  It may write past the completed bytes,
+      /// which later appends overwrite, so at least 8 bytes from p must be inside the stream.
+      void appendWide(uint64_t bits, unsigned n)
+      {
+         pending |= bits << pendingBits;
+         pendingBits += n;
+
+         memcpy(p, &pending, sizeof(pending));
+
+         const unsigned bytes = pendingBits / 8;
+         p += bytes;
+         pending = (bytes > 0) ? pending >> (8*bytes) : pending;
+         pendingBits %= 8;
+      }
+
+      /// Add n bits, n at most 56, storing only completed bytes
+      void append(uint64_t bits, unsigned n)
+      {
+         pending |= bits << pendingBits;
+         pendingBits += n;
+
+         while (pendingBits >= 8)
+         {
+            *p++ = static_cast<uint8_t>(pending);
+            pending >>= 8;
+            pendingBits -= 8;
+         }
+      }
+
+      void finish()
+      {
+         if (pendingBits > 0)
+         {
+            *p = static_cast<uint8_t>(pending);
+         }
+      }
+   };
+
+   /// Packing kernels do groups of 8 values and return how many values they did, the scalar loop finishes the rest.
+   /// end is one past the last byte of the stream.
+   using PackFunction = size_t (*)(const uint32_t* in, unsigned bitsPerValue, size_t count, BitWriter& writer, const uint8_t* end);
+
+   size_t packNone(const uint32_t*, unsigned, size_t, BitWriter&, const uint8_t*)
+   {
+      return 0;
+   }
+
+   void packScalar(const uint32_t* in, unsigned bitsPerValue, size_t count, BitWriter& writer, const uint8_t* end)
+   {
+      for (size_t i = 0; i < count; i++)
+      {
+         if (end - writer.p >= 8)
+         {
+            writer.appendWide(in[i], bitsPerValue);
+         }
+         else
+         {
+            writer.append(in[i], bitsPerValue);
+         }
+      }
+   }
+
+#ifdef E57_UNPACK_X86
+   /// Merges neighbouring values inside the vector, so the writer gets one field per ValuesPerChunk values instead of
+   /// one per value.  Chunks must fit an appendWide(): 2 values up to 28 bits, 4 up to 14 bits, 8 up to 7 bits.
+   template <unsigned ValuesPerChunk>
+   E57_TARGET_AVX2 size_t packAvx2(const uint32_t* in, unsigned bitsPerValue, size_t count, BitWriter& writer, const uint8_t* end)
+   {
+      const __m256i lowMask = _mm256_set1_epi64x(0xFFFFFFFF);
+      const __m128i pairShift = _mm_cvtsi32_si128(static_cast<int>(bitsPerValue));
+      const __m128i quadShift = _mm_cvtsi32_si128(static_cast<int>(2*bitsPerValue));
+
+      alignas(32) uint64_t chunk[4];
+
+      /// A group is bitsPerValue bytes long, and the last store of a group writes 8 bytes from inside it
+      size_t done = 0;
+      for (; done + 8 <= count && static_cast<size_t>(end - writer.p) >= bitsPerValue + 8; done += 8)
+      {
+         const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done));
+
+         /// Each 64 bit lane holds an even and an odd value, move the odd one down to just above the even one
+         __m256i merged = _mm256_or_si256(_mm256_and_si256(v, lowMask), _mm256_sll_epi64(_mm256_srli_epi64(v, 32), pairShift));
+
+         if (ValuesPerChunk >= 4)
+         {
+            /// Same again with the neighbouring 64 bit lane, leaving 4 values in lanes 0 and 2
+            merged = _mm256_or_si256(merged, _mm256_sll_epi64(_mm256_bsrli_epi128(merged, 8), quadShift));
+         }
+
+         _mm256_store_si256(reinterpret_cast<__m256i*>(chunk), merged);
+
+         if (ValuesPerChunk == 8)
+         {
+            writer.appendWide(chunk[0] | (chunk[2] << 4*bitsPerValue), 8*bitsPerValue);
+         }
+         else if (ValuesPerChunk == 4)
+         {
+            writer.appendWide(chunk[0], 4*bitsPerValue);
+            writer.appendWide(chunk[2], 4*bitsPerValue);
+         }
+         else
+         {
+            for (unsigned k = 0; k < 4; k++)
+            {
+               writer.appendWide(chunk[k], 2*bitsPerValue);
+            }
+         }
+      }
+
+      return done;
+   }
+#endif
+
+   template <unsigned ValuesPerChunk>
+   PackFunction selectPackFunction()
+   {
+#ifdef E57_UNPACK_X86
+      if (cpuFeatures().hasAvx2)
+      {
+         return packAvx2<ValuesPerChunk>;
+      }
+#endif
+
+      return packNone;
+   }
+}
+
+void e57::unpackBits(const char* in, size_t firstBit, unsigned bitsPerValue, size_t count, uint32_t* out)
+{
+   static const UnpackFunction unpackFunction = selectUnpackFunction();
+
+   auto p = reinterpret_cast<const uint8_t*>(in);
+
+   size_t done = 0;
+   if (bitsPerValue <= maxKernelBits)
+   {
+      done = unpackFunction(p, firstBit, bitsPerValue, count, out);
+   }
+
+   unpackScalar(p, firstBit + done*bitsPerValue, bitsPerValue, count - done, out + done);
+}
+
+void e57::scaleUnpacked(const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset, double* out)
+{
+   scaleValues(raw, count, minimum, scale, offset, out);
+}
+
+void e57::scaleUnpacked(const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset, float* out)
+{
+   scaleValues(raw, count, minimum, scale, offset, out);
+}
+
+bool e57::subtractMinimum(const int64_t* values, size_t count, int64_t minimum, int64_t maximum, uint32_t* out)
+{
+   static const SubtractFunction subtractFunction = selectSubtractFunction();
+
+   bool inRange = true;
+
+   const size_t done = subtractFunction(values, count, minimum, maximum, out, inRange);
+   subtractScalar(values + done, count - done, minimum, maximum, out + done, inRange);
+
+   return inRange;
+}
+
+void e57::packBits(const uint32_t* in, unsigned bitsPerValue, size_t count, char* out, size_t firstBit)
+{
+   static const PackFunction packEights = selectPackFunction<8>();
+   static const PackFunction packFours = selectPackFunction<4>();
+   static const PackFunction packPairs = selectPackFunction<2>();
+
+   auto p = reinterpret_cast<uint8_t*>(out);
+   const uint8_t* end = p + (firstBit + count*bitsPerValue + 7) / 8;
+
+   BitWriter writer(p + firstBit / 8, firstBit % 8);
+
+   PackFunction packFunction = packNone;
+   if (bitsPerValue <= 7)
+   {
+      packFunction = packEights;
+   }
+   else if (bitsPerValue <= 14)
+   {
+      packFunction = packFours;
+   }
+   else if (bitsPerValue <= 28)
+   {
+      packFunction = packPairs;
+   }
+
+   const size_t done = packFunction(in, bitsPerValue, count, writer, end);
+   packScalar(in + done, bitsPerValue, count - done, writer, end);
+
+   writer.finish();
+}
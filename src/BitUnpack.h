@@ -0,0 +1,59 @@
+#ifndef BITUNPACK_H
+#define BITUNPACK_H
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace e57
+{
+   /// Extract count values of bitsPerValue bits each (1 to 32), packed back to back starting at bit firstBit of
+   /// the little endian bitstream at in, into out.  Only bytes holding bits of the values are read, so in needs
+   /// (firstBit + count*bitsPerValue + 7)/8 readable bytes.
+   /// Widths up to 25 bits go through an AVX2 or SSE4.1 kernel if the CPU has one, picked once on first call,
+   /// everything else through a scalar loop.
+   void unpackBits(const char* in, size_t firstBit, unsigned bitsPerValue, size_t count, uint32_t* out);
+
+   /// Set out[i] = (minimum + raw[i])*scale + offset for count unpacked ScaledInteger values, computed in double and
+   /// rounded exactly as one value at a time would be.  minimum must be less than 2^52 in magnitude.
+   /// Uses AVX2 if the CPU has it.
+   void scaleUnpacked(const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset, double* out);
+   void scaleUnpacked(const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset, float* out);
+
+   /// Set out[i] = values[i] - minimum for count values.  Returns false if any value is outside [minimum, maximum],
+   /// in which case out is not meaningful.  maximum - minimum must be less than 2^32.  Uses AVX2 if the CPU has it.
+   bool subtractMinimum(const int64_t* values, size_t count, int64_t minimum, int64_t maximum, uint32_t* out);
+
+   /// Inverse of unpackBits(): pack count values of bitsPerValue bits each (1 to 32) back to back, starting at bit
+   /// firstBit of the little endian bitstream at out.  Values must not have bits set above bitsPerValue.
+   /// Bits below firstBit in its byte are kept, the rest of the (firstBit + count*bitsPerValue + 7)/8 bytes are
+   /// overwritten, with zeros after the last value.  No other bytes are touched.
+   /// Widths up to 28 bits are combined a group of 8 values at a time with AVX2 if the CPU has it.
+   void packBits(const uint32_t* in, unsigned bitsPerValue, size_t count, char* out, size_t firstBit);
+}
+
+#endif
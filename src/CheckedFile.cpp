@@ -40,12 +40,16 @@
 #elif defined(__linux__)
 #define _LARGEFILE64_SOURCE
 #define __LARGE64_FILES
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#define E57_MMAP_READ
 #elif defined(__APPLE__)
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
+#define E57_MMAP_READ
 #else
 #error "no supported OS platform defined"
 #endif
@@ -53,10 +57,12 @@
 #include <cmath>
 #include <cstring>
 #include <fcntl.h>
-
-#include "CRC.h"
+#include <limits>
+#include <mutex>
 
 #include "CheckedFile.h"
+#include "Checksum.h"
+#include "WorkerPool.h"
 
 //#define E57_CHECK_FILE_DEBUG
 #ifdef E57_CHECK_FILE_DEBUG
@@ -81,6 +87,25 @@ constexpr size_t     CheckedFile::physicalPageSize;
 constexpr uint64_t   CheckedFile::physicalPageSizeMask;
 constexpr size_t     CheckedFile::logicalPageSize;
 
+/// How far ahead of the current read to ask the OS to page in a memory mapped file
+constexpr uint64_t   readaheadSize = 2*1024*1024;
+
+/// Most physical pages read() will get from fd_ in one system call, or check in place in memory at once
+constexpr size_t     maxReadPageCount = 1024;
+
+/// Fewest pages worth handing to another thread to verify
+constexpr size_t     minParallelChecksumPages = 64;
+
+/// Most physical pages write() will hold back before writing them to fd_ with one system call
+constexpr size_t     maxWritePageCount = 256;
+
+namespace
+{
+   /// Shared by all files, only exists if more than one thread was asked for
+   mutex                   checksumPoolMutex;
+   shared_ptr<WorkerPool>  checksumPool;
+}
+
 
 /// Tool class to read buffer efficiently without 
 /// multiplying copy operations.
@@ -128,12 +153,29 @@ class e57::BufferView
 
       void read( char* buffer, uint64_t count )
       {
-         const uint64_t start = cursorStream_;
-         for ( uint64_t i = 0; i < count; ++i )
+         memcpy( buffer, stream_ + cursorStream_, count );
+         cursorStream_ += count;
+      }
+
+      /// Direct access to @a count bytes at @a offset, nullptr if they aren't all in the buffer
+      const char* data( uint64_t offset, uint64_t count ) const
+      {
+         if ( offset > streamSize_ || count > streamSize_ - offset )
          {
-            buffer[i] = stream_[start + i];
-            ++cursorStream_;
+            return nullptr;
          }
+
+         return stream_ + offset;
+      }
+
+      const char* data() const
+      {
+         return stream_;
+      }
+
+      uint64_t size() const
+      {
+         return streamSize_;
       }
 
    private:
@@ -158,6 +200,9 @@ CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy
          lseek64( 0, SEEK_SET );
 
          logicalLength_ = physicalToLogical( physicalLength_ );
+
+         /// Read straight from memory if we can, otherwise stay with read() on fd_
+         mapFile();
          break;
 
       case WriteCreate:
@@ -168,7 +213,10 @@ CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy
       case WriteExisting:
          fd_ = open64(fileName_, O_RDWR|O_BINARY, 0);
 
-         logicalLength_ = physicalToLogical(length(Physical)); //???
+         physicalLength_ = lseek64(0LL, SEEK_END);
+         lseek64( 0, SEEK_SET );
+
+         logicalLength_ = physicalToLogical(physicalLength_); //???
          break;
    }
 }
@@ -177,6 +225,7 @@ CheckedFile::CheckedFile( const char* input, uint64_t size, ReadChecksumPolicy p
    fileName_( "<StreamBuffer>" ),
    checkSumPolicy_( policy )
 {
+   /// Same as a memory mapped file, except the memory belongs to the caller
    bufView_ = new BufferView(input, size);
 
    readOnly_ = true;
@@ -222,6 +271,62 @@ int CheckedFile::open64( const ustring &fileName, int flags, int mode )
 }
 
 
+void CheckedFile::mapFile()
+{
+#ifdef E57_MMAP_READ
+   /// Can't map an empty file, or one bigger than our address space
+   if ( physicalLength_ == 0 || physicalLength_ > static_cast<uint64_t>(numeric_limits<size_t>::max()) )
+   {
+      return;
+   }
+
+   void* addr = ::mmap( nullptr, static_cast<size_t>(physicalLength_), PROT_READ, MAP_SHARED, fd_, 0 );
+   if ( addr == MAP_FAILED )
+   {
+      return;
+   }
+
+   bufView_ = new BufferView( static_cast<const char*>(addr), physicalLength_ );
+   mapped_ = true;
+
+   /// Mapping stays valid after fd_ is closed, and from now on all reads go through bufView_
+   ::close( fd_ );
+   fd_ = -1;
+#endif
+}
+
+void CheckedFile::readahead( uint64_t physicalOffset )
+{
+#ifdef E57_MMAP_READ
+   /// Only need to ask again when reader has jumped out of, or is getting close to the end of, the previous window.
+   /// Readers on other threads may move the window at the same time, which at worst asks for a range twice.
+   const uint64_t windowStart = readaheadStart_.load( memory_order_relaxed );
+   const uint64_t windowEnd = readaheadEnd_.load( memory_order_relaxed );
+   if ( physicalOffset >= windowStart && physicalOffset + readaheadSize/2 < windowEnd )
+   {
+      return;
+   }
+
+   static const auto systemPageSize = static_cast<uint64_t>( sysconf(_SC_PAGESIZE) );
+
+   const uint64_t start = physicalOffset - physicalOffset % systemPageSize;
+   const uint64_t end = min( start + readaheadSize, physicalLength_ );
+
+   if ( start >= end )
+   {
+      return;
+   }
+
+   /// Just a hint, so don't care if it fails
+   ::madvise( const_cast<char*>(bufView_->data()) + start, static_cast<size_t>(end - start), MADV_WILLNEED );
+
+   readaheadStart_.store( start, memory_order_relaxed );
+   readaheadEnd_.store( end, memory_order_relaxed );
+#else
+   (void)physicalOffset;
+#endif
+}
+
 CheckedFile::~CheckedFile()
 {
    try {
@@ -229,6 +334,15 @@ CheckedFile::~CheckedFile()
    } catch (...) {
       //??? report?
    }
+
+   /// close() may have failed before getting to it
+   if ( writeThread_.joinable() )
+   {
+      try {
+         stopWriteThread();
+      } catch (...) {
+      }
+   }
 }
 
 void CheckedFile::read(char* buf, size_t nRead, size_t /*bufSize*/)
@@ -245,52 +359,104 @@ void CheckedFile::read(char* buf, size_t nRead, size_t /*bufSize*/)
       throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "fileName=" + fileName_ + " end=" + toString(end) + " length=" + toString(logicalLength));
    }
 
+   /// Reading back what we wrote, so it has to be in the file first
+   flushWriteBuffer();
+   waitForWrite();
+
    uint64_t page = 0;
    size_t   pageOffset = 0;
 
    getCurrentPageAndOffset(page, pageOffset);
 
-   size_t n = min( nRead, logicalPageSize - pageOffset );
+   readPages( page, pageOffset, buf, nRead, readBuffer_ );
+
+   /// When done, leave cursor just past end of last byte read
+   seek(end, Logical);
+}
+
+/// Doesn't use or move the file cursor, so readers on several threads can call it at once on a read only file
+void CheckedFile::readAt(uint64_t logicalOffset, char* buf, size_t nRead)
+{
+   /// Writers read back through the cursor, after flushing what they wrote
+   if ( !readOnly_ )
+   {
+      seek( logicalOffset, Logical );
+      read( buf, nRead );
+      return;
+   }
+
+   if ( logicalOffset > logicalLength_ || nRead > logicalLength_ - logicalOffset )
+   {
+      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "fileName=" + fileName_ + " end=" + toString(logicalOffset + nRead) + " length=" + toString(logicalLength_));
+   }
+
+   const uint64_t page = logicalOffset / logicalPageSize;
+   const size_t   pageOffset = static_cast<size_t>(logicalOffset - page*logicalPageSize);
+
+#if defined(_WIN32)
+   /// No pread(), so reads from fd_ have to move the file cursor one at a time
+   unique_lock<mutex> lock( readMutex_, defer_lock );
+   if ( bufView_ == nullptr )
+   {
+      lock.lock();
+   }
+#endif
 
-   /// Allocate temp page buffer
-   vector<char> page_buffer_v( physicalPageSize );
-   char* page_buffer = &page_buffer_v[0];
+   /// Each thread stages its own reads from fd_
+   static thread_local vector<char> stagingBuffer;
 
-   auto   checksumMod = static_cast<const unsigned int>( std::nearbyint( 100.0 / checkSumPolicy_ ) );
+   readPages( page, pageOffset, buf, nRead, stagingBuffer );
+}
 
+void CheckedFile::readPages(uint64_t page, size_t pageOffset, char* buf, size_t nRead, vector<char>& stagingBuffer)
+{
    while ( nRead > 0 )
    {
-      readPhysicalPage( page_buffer, page );
+      /// Get a run of the pages we still need.  In memory files can be checked and copied from where they are,
+      /// otherwise read as many as will fit in stagingBuffer with one call.
+      const uint64_t pagesNeeded = (pageOffset + nRead + logicalPageSize - 1) / logicalPageSize;
+      const size_t   pageCount = static_cast<size_t>( min<uint64_t>(pagesNeeded, maxReadPageCount) );
 
-      switch ( checkSumPolicy_ )
+      const char* pages = nullptr;
+      if ( bufView_ != nullptr )
       {
-         case CHECKSUM_POLICY_NONE:
-            break;
-
-         case CHECKSUM_POLICY_ALL:
-            verifyChecksum( page_buffer, page );
-            break;
-
-         default:
-            if ( !(page % checksumMod) || (nRead < physicalPageSize) )
-            {
-               verifyChecksum( page_buffer, page );
-            }
-            break;
+         if ( mapped_ )
+         {
+            readahead( page*physicalPageSize );
+         }
+
+         pages = bufView_->data( page*physicalPageSize, pageCount*physicalPageSize );
+         if ( pages == nullptr )
+         {
+            throw E57_EXCEPTION2(E57_ERROR_READ_FAILED, "fileName=" + fileName_ + " page=" + toString(page));
+         }
       }
+      else
+      {
+         if ( stagingBuffer.size() < pageCount*physicalPageSize )
+         {
+            stagingBuffer.resize( pageCount*physicalPageSize );
+         }
 
-      memcpy( buf, page_buffer+pageOffset, n );
+         readPhysicalPages( stagingBuffer.data(), page, pageCount );
+         pages = stagingBuffer.data();
+      }
 
-      buf += n;
-      nRead -= n;
-      pageOffset = 0;
-      ++page;
+      verifyChecksums( pages, page, pageCount, pageOffset, nRead );
 
-      n = min( nRead, logicalPageSize );
-   }
+      for ( size_t i = 0; i < pageCount; ++i )
+      {
+         const size_t n = min( nRead, logicalPageSize - pageOffset );
 
-   /// When done, leave cursor just past end of last byte read
-   seek(end, Logical);
+         memcpy( buf, pages + i*physicalPageSize + pageOffset, n );
+
+         buf += n;
+         nRead -= n;
+         pageOffset = 0;
+      }
+
+      page += pageCount;
+   }
 }
 
 void CheckedFile::write(const char* buf, size_t nWrite)
@@ -310,38 +476,19 @@ void CheckedFile::write(const char* buf, size_t nWrite)
 
    getCurrentPageAndOffset(page, pageOffset);
 
-   size_t n = min(nWrite, logicalPageSize - pageOffset);
-
-   /// Allocate temp page buffer
-   vector<char> page_buffer_v(physicalPageSize);
-   char* page_buffer = &page_buffer_v[0];
-
+   /// Only copy into writeBuffer_ here.  Checksums are calculated, and pages written, once per flushWriteBuffer().
    while (nWrite > 0)
    {
-      const uint64_t physicalLength = length( Physical );
+      const size_t n = min(nWrite, logicalPageSize - pageOffset);
 
-      if ( page*physicalPageSize < physicalLength )
-      {
-         readPhysicalPage( page_buffer, page );
-      }
+      char* page_buffer = bufferedPage( page, n == logicalPageSize );
 
-#ifdef E57_MAX_VERBOSE
-      // cout << "  page_buffer[0] read: '" << page_buffer[0] << "'" << endl;
-      // cout << "copy " << n << "bytes to page=" << page << " pageOffset=" << pageOffset << " buf='"; //???
-      //for (size_t i=0; i < n; i++)
-         // cout << buf[i];
-         // cout << "'" << endl;
-#endif
       memcpy(page_buffer+pageOffset, buf, n);
-      writePhysicalPage(page_buffer, page);
-#ifdef E57_MAX_VERBOSE
-      // cout << "  page_buffer[0] after write: '" << page_buffer[0] << "'" << endl; //???
-#endif
+
       buf += n;
       nWrite -= n;
       pageOffset = 0;
       page++;
-      n = min(nWrite, logicalPageSize);
    }
 
    if (end > logicalLength_)
@@ -528,21 +675,10 @@ uint64_t CheckedFile::length( OffsetMode omode )
 {
    if ( omode == Physical )
    {
-      if ( readOnly_ )
-      {
-         return physicalLength_;
-      }
-
-      // Current file position
-      uint64_t original_pos = lseek64( 0LL, SEEK_CUR );
-
-      // End file position
-      uint64_t end_pos = lseek64( 0LL, SEEK_END );
+      /// Pages still in writeBuffer_ may go past the end of what has been written to the file
+      const uint64_t bufferedEnd = (writeBufferPage_ + writeBufferPageCount_) * physicalPageSize;
 
-      // Restore original position
-      lseek64( original_pos, SEEK_SET );
-
-      return end_pos;
+      return (writeBufferPageCount_ > 0) ? max( physicalLength_, bufferedEnd ) : physicalLength_;
    }
 
    return logicalLength_;
@@ -586,55 +722,17 @@ void CheckedFile::extend(uint64_t newLength, OffsetMode omode)
    /// Seek to current end of file
    seek(currentLogicalLength, Logical);
 
-   uint64_t page = 0;
-   size_t   pageOffset = 0;
-
-   getCurrentPageAndOffset(page, pageOffset);
-
-   /// Calc first write size (may be partial page)
-   /// Watch out for different int sizes here.
-   size_t n = 0;
-
-   if (nWrite < logicalPageSize - pageOffset)
-   {
-      n = static_cast<size_t>(nWrite);
-   }
-   else
-   {
-      n = logicalPageSize - pageOffset;
-   }
-
-   /// Allocate temp page buffer
-   vector<char> page_buffer_v(physicalPageSize);
-   char* page_buffer = &page_buffer_v[0];
+   /// Zeros go through the same page buffer as any other write
+   static const char zeros[logicalPageSize] = {};
 
    while (nWrite > 0)
    {
-      const uint64_t physicalLength = length( Physical );
-
-      if ( page*physicalPageSize < physicalLength )
-      {
-         readPhysicalPage( page_buffer, page );
-      }
+      /// Watch out for different int sizes here.
+      const size_t n = static_cast<size_t>( min<uint64_t>(nWrite, logicalPageSize) );
 
-#ifdef E57_MAX_VERBOSE
-      // cout << "extend " << n << "bytes on page=" << page << " pageOffset=" << pageOffset << endl; //???
-#endif
-      memset(page_buffer+pageOffset, 0, n);
-      writePhysicalPage(page_buffer, page);
+      write( zeros, n );
 
       nWrite -= n;
-      pageOffset = 0;
-      ++page;
-
-      if (nWrite < logicalPageSize)
-      {
-         n = static_cast<size_t>(nWrite);
-      }
-      else
-      {
-         n = logicalPageSize;
-      }
    }
 
    //??? what if loop above throws, logicalLength_ may be wrong
@@ -648,6 +746,13 @@ void CheckedFile::close()
 {
    if (fd_ >= 0)
    {
+      flushWriteBuffer();
+
+      if ( writeThread_.joinable() )
+      {
+         stopWriteThread();
+      }
+
 #if defined(_MSC_VER)
       int result = ::_close(fd_);
 #elif defined(__GNUC__)
@@ -665,16 +770,27 @@ void CheckedFile::close()
 
    if (bufView_ != nullptr) 
    {
+#ifdef E57_MMAP_READ
+      if ( mapped_ )
+      {
+         ::munmap( const_cast<char*>(bufView_->data()), static_cast<size_t>(bufView_->size()) );
+         mapped_ = false;
+      }
+#endif
+
       delete bufView_;
       bufView_ = nullptr;
 
-      // WARNING: do NOT delete buffer of bufView_ because
+      // WARNING: do NOT delete buffer of bufView_ unless we mapped it because
       // pointer is handled by user !!
    }
 }
 
 void CheckedFile::unlink()
 {
+   /// No point writing out pages of a file about to be deleted
+   writeBufferPageCount_ = 0;
+
    close();
 
    /// Try to unlink the file, don't report a failure
@@ -695,19 +811,9 @@ inline uint32_t swap_uint32( uint32_t val )
 }
 
 /// Calc CRC32C of given data
-uint32_t CheckedFile::checksum(char* buf, size_t size) const
-{
-   static const CRC::Parameters<crcpp_uint32, 32> sCRCParams{
-      0x1EDC6F41,
-      0xFFFFFFFF,
-      0xFFFFFFFF,
-      true,
-      true
-   };
-
-   static const CRC::Table<crcpp_uint32, 32>   sCRCTable = sCRCParams.MakeTable();
-
-   auto crc = CRC::Calculate<crcpp_uint32, 32>( buf, size, sCRCTable );
+uint32_t CheckedFile::checksum(const char* buf, size_t size) const
+{
+   auto crc = crc32c( buf, size );
 
    // (Andy) I don't understand why we need to swap bytes here
    crc = swap_uint32( crc );
@@ -715,10 +821,65 @@ uint32_t CheckedFile::checksum(char* buf, size_t size) const
    return crc;
 }
 
-void CheckedFile::verifyChecksum( char *page_buffer, size_t page )
+void CheckedFile::verifyChecksums( const char* pages, uint64_t firstPage, size_t pageCount, size_t pageOffset, uint64_t nRead )
+{
+   if ( checkSumPolicy_ == CHECKSUM_POLICY_NONE )
+   {
+      return;
+   }
+
+   const auto checksumMod = static_cast<unsigned int>( std::nearbyint( 100.0 / checkSumPolicy_ ) );
+
+   const auto verifyRange = [&]( size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; ++i )
+      {
+         const uint64_t page = firstPage + i;
+
+         /// Sparse policies check every checksumMod'th page, plus the last page of a read.
+         /// nRead is bytes left to read at start of first page.
+         const uint64_t bytesLeft = (i == 0) ? nRead : nRead - (logicalPageSize - pageOffset) - (i - 1)*logicalPageSize;
+
+         if ( checkSumPolicy_ == CHECKSUM_POLICY_ALL || !(page % checksumMod) || (bytesLeft < physicalPageSize) )
+         {
+            verifyChecksum( pages + i*physicalPageSize, page );
+         }
+      }
+   };
+
+   shared_ptr<WorkerPool> pool;
+   if ( pageCount >= 2*minParallelChecksumPages )
+   {
+      lock_guard<mutex> lock( checksumPoolMutex );
+      pool = checksumPool;
+   }
+
+   if ( pool )
+   {
+      pool->parallelFor( pageCount, minParallelChecksumPages, verifyRange );
+   }
+   else
+   {
+      verifyRange( 0, pageCount );
+   }
+}
+
+void CheckedFile::setChecksumThreadCount( unsigned threadCount )
+{
+   shared_ptr<WorkerPool> pool;
+   if ( threadCount > 1 )
+   {
+      pool = make_shared<WorkerPool>( threadCount );
+   }
+
+   /// Old pool goes away when the last read using it finishes
+   lock_guard<mutex> lock( checksumPoolMutex );
+   checksumPool.swap( pool );
+}
+
+void CheckedFile::verifyChecksum( const char *page_buffer, size_t page )
 {
    const uint32_t check_sum = checksum( page_buffer, logicalPageSize );
-   const uint32_t check_sum_in_page = *reinterpret_cast<uint32_t*>(&page_buffer[logicalPageSize]);
+   const uint32_t check_sum_in_page = *reinterpret_cast<const uint32_t*>(&page_buffer[logicalPageSize]);
 
    if ( check_sum_in_page != check_sum )
    {
@@ -784,29 +945,282 @@ void CheckedFile::readPhysicalPage(char* page_buffer, uint64_t page)
    }
 }
 
-void CheckedFile::writePhysicalPage(char* page_buffer, uint64_t page)
+void CheckedFile::readPhysicalPages(char* buffer, uint64_t page, size_t pageCount)
+{
+   uint64_t offset = page*physicalPageSize;
+   size_t   nRead = pageCount*physicalPageSize;
+
+#if defined(_WIN32)
+   /// No pread(), so have to move the file cursor
+   seek( offset, Physical );
+#endif
+
+   /// May take more than one call to get it all
+   while ( nRead > 0 )
+   {
+#if defined(_MSC_VER)
+      int result = ::_read( fd_, buffer, static_cast<unsigned>(nRead) );
+#elif defined(_WIN32)
+      ssize_t result = ::read( fd_, buffer, nRead );
+#elif defined(__linux__)
+      ssize_t result = ::pread64( fd_, buffer, nRead, static_cast<off64_t>(offset) );
+#elif defined(__APPLE__)
+      ssize_t result = ::pread( fd_, buffer, nRead, static_cast<off_t>(offset) );
+#else
+#  error "no supported OS platform defined"
+#endif
+
+      if ( result <= 0 )
+      {
+         throw E57_EXCEPTION2(E57_ERROR_READ_FAILED,
+                              "fileName=" + fileName_
+                              + " offset=" + toString(offset)
+                              + " result=" + toString(result));
+      }
+
+      buffer += result;
+      nRead -= static_cast<size_t>(result);
+      offset += static_cast<uint64_t>(result);
+   }
+}
+
+void CheckedFile::writePhysicalPages(const char* buffer, uint64_t page, size_t pageCount)
 {
 #ifdef E57_MAX_VERBOSE
-   // cout << "writePhysicalPage, page:" << page << endl;
+   // cout << "writePhysicalPages, page:" << page << " pageCount:" << pageCount << endl;
 #endif
 
-   /// Append checksum
-   uint32_t check_sum = checksum(page_buffer, logicalPageSize);
-   *reinterpret_cast<uint32_t*>(&page_buffer[logicalPageSize]) = check_sum;  //??? little endian dependency
+   uint64_t offset = page*physicalPageSize;
+   size_t   nWrite = pageCount*physicalPageSize;
 
-   /// Seek to start of physical page
-   seek(page*physicalPageSize, Physical);
+#if defined(_WIN32)
+   /// No pwrite(), so have to move the file cursor, and put it back after
+   const uint64_t originalPos = position( Physical );
+   seek( offset, Physical );
+#endif
 
+   /// May take more than one call to get it all
+   while ( nWrite > 0 )
+   {
 #if defined(_MSC_VER)
-   int result = ::_write(fd_, page_buffer, physicalPageSize);
-#elif defined(__GNUC__)
-   ssize_t result = ::write(fd_, page_buffer, physicalPageSize);
+      int result = ::_write( fd_, buffer, static_cast<unsigned>(nWrite) );
+#elif defined(_WIN32)
+      ssize_t result = ::write( fd_, buffer, nWrite );
+#elif defined(__linux__)
+      ssize_t result = ::pwrite64( fd_, buffer, nWrite, static_cast<off64_t>(offset) );
+#elif defined(__APPLE__)
+      ssize_t result = ::pwrite( fd_, buffer, nWrite, static_cast<off_t>(offset) );
 #else
-#  error "no supported compiler defined"
+#  error "no supported OS platform defined"
 #endif
 
-   if (result < 0)
+      if ( result <= 0 )
+      {
+         throw E57_EXCEPTION2(E57_ERROR_WRITE_FAILED,
+                              "fileName=" + fileName_
+                              + " offset=" + toString(offset)
+                              + " result=" + toString(result));
+      }
+
+      buffer += result;
+      nWrite -= static_cast<size_t>(result);
+      offset += static_cast<uint64_t>(result);
+   }
+
+#if defined(_WIN32)
+   seek( originalPos, Physical );
+#endif
+}
+
+char* CheckedFile::bufferedPage(uint64_t page, bool overwriteAll)
+{
+   if ( writeBufferPageCount_ > 0 && page >= writeBufferPage_ && page < writeBufferPage_ + writeBufferPageCount_ )
+   {
+      return &writeBuffer_[static_cast<size_t>(page - writeBufferPage_) * physicalPageSize];
+   }
+
+   /// Run can only grow at its end.  Moving anywhere else, or past a full run, writes out what we have.
+   if ( writeBufferPageCount_ == 0 || page != writeBufferPage_ + writeBufferPageCount_ || writeBufferPageCount_ == maxWritePageCount )
+   {
+      flushWriteBuffer();
+      writeBufferPage_ = page;
+   }
+
+   if ( writeBuffer_.size() < (writeBufferPageCount_ + 1) * physicalPageSize )
+   {
+      writeBuffer_.resize( maxWritePageCount * physicalPageSize );
+   }
+
+   char* page_buffer = &writeBuffer_[writeBufferPageCount_ * physicalPageSize];
+
+   /// Parts of an existing page we don't write over have to be kept.  This is the only time it is read back.
+   if ( !overwriteAll && page*physicalPageSize < physicalLength_ )
+   {
+      waitForWrite();
+      readPhysicalPage( page_buffer, page );
+   }
+   else
+   {
+      memset( page_buffer, 0, physicalPageSize );
+   }
+
+   ++writeBufferPageCount_;
+
+   return page_buffer;
+}
+
+void CheckedFile::flushWriteBuffer()
+{
+   if ( writeBufferPageCount_ == 0 )
    {
-      throw E57_EXCEPTION2(E57_ERROR_WRITE_FAILED, "fileName=" + fileName_ + " result=" + toString(result));
+      return;
+   }
+
+   /// Forget the pages first, so a failed write isn't tried again by close()
+   const size_t pageCount = writeBufferPageCount_;
+   writeBufferPageCount_ = 0;
+
+   const uint64_t end = (writeBufferPage_ + pageCount) * physicalPageSize;
+
+   if ( writeThread_.joinable() )
+   {
+      /// Only one run in flight at a time.  Once the last one is out, hand over this one and fill the other buffer.
+      waitForWrite();
+
+      {
+         lock_guard<mutex> lock( writeMutex_ );
+
+         writeBuffer_.swap( pendingBuffer_ );
+         pendingPage_ = writeBufferPage_;
+         pendingPageCount_ = pageCount;
+      }
+      writeChanged_.notify_all();
+
+      physicalLength_ = max( physicalLength_, end );
+      return;
+   }
+
+   checksumPages( writeBuffer_.data(), pageCount );
+   writePhysicalPages( writeBuffer_.data(), writeBufferPage_, pageCount );
+
+   physicalLength_ = max( physicalLength_, end );
+}
+
+void CheckedFile::checksumPages(char* pages, size_t pageCount) const
+{
+   /// Append checksums
+   for ( size_t i = 0; i < pageCount; ++i )
+   {
+      char* page_buffer = &pages[i * physicalPageSize];
+
+      uint32_t check_sum = checksum(page_buffer, logicalPageSize);
+      *reinterpret_cast<uint32_t*>(&page_buffer[logicalPageSize]) = check_sum;  //??? little endian dependency
+   }
+}
+
+void CheckedFile::setBackgroundWrite(bool enable)
+{
+#if defined(_WIN32)
+   /// writePhysicalPages() would have to move the file cursor from under the caller
+   (void)enable;
+#else
+   if ( enable == writeThread_.joinable() )
+   {
+      return;
+   }
+
+   if ( !enable )
+   {
+      stopWriteThread();
+      return;
+   }
+
+   if (readOnly_)
+   {
+      throw E57_EXCEPTION2(E57_ERROR_FILE_IS_READ_ONLY, "fileName=" + fileName_);
+   }
+
+   writeStopping_ = false;
+   writeThread_ = thread( &CheckedFile::writeLoop, this );
+#endif
+}
+
+void CheckedFile::writeLoop()
+{
+   unique_lock<mutex> lock( writeMutex_ );
+
+   while ( true )
+   {
+      writeChanged_.wait( lock, [this] { return writeStopping_ || pendingPageCount_ > 0; } );
+
+      /// Finish the run in hand before stopping
+      if ( pendingPageCount_ == 0 )
+      {
+         return;
+      }
+
+      /// Caller doesn't touch pendingBuffer_ until pendingPageCount_ goes back to zero
+      lock.unlock();
+
+      exception_ptr error;
+      try
+      {
+         checksumPages( pendingBuffer_.data(), pendingPageCount_ );
+         writePhysicalPages( pendingBuffer_.data(), pendingPage_, pendingPageCount_ );
+      }
+      catch (...)
+      {
+         error = current_exception();
+      }
+
+      lock.lock();
+
+      if ( error && !writeError_ )
+      {
+         writeError_ = error;
+      }
+
+      pendingPageCount_ = 0;
+      writeChanged_.notify_all();
+   }
+}
+
+void CheckedFile::waitForWrite()
+{
+   if ( !writeThread_.joinable() )
+   {
+      return;
+   }
+
+   unique_lock<mutex> lock( writeMutex_ );
+
+   writeChanged_.wait( lock, [this] { return pendingPageCount_ == 0; } );
+
+   /// Report a failure once, the same way a write in this thread would have
+   if ( writeError_ )
+   {
+      exception_ptr error = writeError_;
+      writeError_ = nullptr;
+
+      rethrow_exception( error );
+   }
+}
+
+void CheckedFile::stopWriteThread()
+{
+   {
+      lock_guard<mutex> lock( writeMutex_ );
+      writeStopping_ = true;
+   }
+   writeChanged_.notify_all();
+
+   writeThread_.join();
+
+   if ( writeError_ )
+   {
+      exception_ptr error = writeError_;
+      writeError_ = nullptr;
+
+      rethrow_exception( error );
    }
 }
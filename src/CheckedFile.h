@@ -28,6 +28,11 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include "Common.h"
 
@@ -65,6 +70,7 @@ namespace e57 {
          ~CheckedFile();
 
          void            read(char* buf, size_t nRead, size_t bufSize = 0);
+         void            readAt(uint64_t logicalOffset, char* buf, size_t nRead);
          void            write(const char* buf, size_t nWrite);
          CheckedFile&    operator<<(const e57::ustring& s);
          CheckedFile&    operator<<(int64_t i);
@@ -82,18 +88,37 @@ namespace e57 {
          static inline uint64_t logicalToPhysical(uint64_t logicalOffset);
          static inline uint64_t physicalToLogical(uint64_t physicalOffset);
 
+         /// Verify checksums of large reads on this many threads, shared by all files.  1 turns it off.
+         static void     setChecksumThreadCount(unsigned threadCount);
+
+         /// Checksum and write out full runs of pages on a background thread, while the caller fills the next run.
+         /// Turning it off waits for the last run to be written.  Write failures are reported by a later call.
+         /// No effect on Windows, which has no pwrite().
+         void            setBackgroundWrite(bool enable);
+
       private:
-         uint32_t    checksum(char* buf, size_t size) const;
-         void        verifyChecksum( char *page_buffer, size_t page );
+         uint32_t    checksum(const char* buf, size_t size) const;
+         void        verifyChecksum( const char *page_buffer, size_t page );
+         void        verifyChecksums( const char* pages, uint64_t firstPage, size_t pageCount, size_t pageOffset, uint64_t nRead );
 
          template<class FTYPE>
          CheckedFile&    writeFloatingPoint(FTYPE value, int precision);
 
          void        getCurrentPageAndOffset(uint64_t& page, size_t& pageOffset, OffsetMode omode = Logical);
+         void        readPages(uint64_t page, size_t pageOffset, char* buf, size_t nRead, std::vector<char>& stagingBuffer);
          void        readPhysicalPage(char* page_buffer, uint64_t page);
-         void        writePhysicalPage(char* page_buffer, uint64_t page);
+         void        readPhysicalPages(char* buffer, uint64_t page, size_t pageCount);
+         void        writePhysicalPages(const char* buffer, uint64_t page, size_t pageCount);
+         char*       bufferedPage(uint64_t page, bool overwriteAll);
+         void        flushWriteBuffer();
+         void        checksumPages(char* pages, size_t pageCount) const;
+         void        writeLoop();
+         void        waitForWrite();
+         void        stopWriteThread();
          int         open64( const e57::ustring &fileName, int flags, int mode );
          uint64_t    lseek64(int64_t offset, int whence);
+         void        mapFile();
+         void        readahead( uint64_t physicalOffset );
 
 
          e57::ustring    fileName_;
@@ -104,7 +129,30 @@ namespace e57 {
 
          int             fd_ = -1;
          BufferView*     bufView_ = nullptr;
+         bool            mapped_ = false;    // bufView_ is a memory mapping of the file, we have to unmap it
          bool            readOnly_ = false;
+
+         std::atomic<uint64_t> readaheadStart_{0};  // physical range last passed to madvise()
+         std::atomic<uint64_t> readaheadEnd_{0};
+
+         std::vector<char> readBuffer_;      // staging buffer for read()s from fd_, kept between reads
+
+         std::mutex      readMutex_;         // keeps readAt() calls from different threads apart where there is no pread()
+
+         /// Run of consecutive physical pages changed by write() but not yet written to fd_, checksums not filled in yet
+         std::vector<char> writeBuffer_;
+         uint64_t        writeBufferPage_ = 0;       // first page in writeBuffer_
+         size_t          writeBufferPageCount_ = 0;  // pages in use in writeBuffer_, zero if nothing waiting to be written
+
+         /// Background writing, see setBackgroundWrite().  flushWriteBuffer() swaps writeBuffer_ with pendingBuffer_.
+         std::thread     writeThread_;               // not joinable if writing in the caller's thread
+         std::mutex      writeMutex_;                // guards the members below
+         std::condition_variable writeChanged_;
+         std::vector<char> pendingBuffer_;           // run of pages being written by writeThread_
+         uint64_t        pendingPage_ = 0;
+         size_t          pendingPageCount_ = 0;      // zero once writeThread_ is done with pendingBuffer_
+         bool            writeStopping_ = false;
+         std::exception_ptr writeError_;             // failure in writeThread_, not yet reported
    };
 
    inline uint64_t CheckedFile::logicalToPhysical(uint64_t logicalOffset)
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define E57_CRC32C_X86
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define E57_TARGET_SSE42
+#define E57_TARGET_SSE42_PCLMUL
+#else
+#include <cpuid.h>
+#define E57_TARGET_SSE42         __attribute__((target("sse4.2")))
+#define E57_TARGET_SSE42_PCLMUL  __attribute__((target("sse4.2,pclmul")))
+#endif
+#endif
+
+#include "Checksum.h"
+
+using namespace e57;
+
+namespace
+{
+   /// Castagnoli polynomial, bit reversed
+   constexpr uint32_t crc32cPolynomial = 0x82F63B78;
+
+   /// All the functions below work on the raw CRC register, without the initial and final inversion.
+   using CrcFunction = uint32_t (*)(uint32_t crc, const char* buf, size_t size);
+
+   /// table[k][i] is the CRC of byte i followed by k zero bytes
+   struct SliceTables
+   {
+      uint32_t table[8][256];
+
+      SliceTables()
+      {
+         for (uint32_t i = 0; i < 256; i++)
+         {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+               crc = (crc >> 1) ^ ((crc & 1) ? crc32cPolynomial : 0);
+            }
+            table[0][i] = crc;
+         }
+
+         for (uint32_t i = 0; i < 256; i++)
+         {
+            for (int k = 1; k < 8; k++)
+            {
+               table[k][i] = (table[k-1][i] >> 8) ^ table[0][table[k-1][i] & 0xFF];
+            }
+         }
+      }
+   };
+
+   uint32_t crc32cSoftware(uint32_t crc, const char* buf, size_t size)
+   {
+      static const SliceTables tables;
+      const auto& t = tables.table;
+
+      auto p = reinterpret_cast<const uint8_t*>(buf);
+
+      /// Slicing-by-8: look up all 8 bytes of a word independently, little endian
+      while (size >= 8)
+      {
+         uint32_t lo = 0;
+         uint32_t hi = 0;
+         memcpy(&lo, p, sizeof(lo));
+         memcpy(&hi, p + 4, sizeof(hi));
+
+         lo ^= crc;
+         crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+             ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+
+         p += 8;
+         size -= 8;
+      }
+
+      while (size > 0)
+      {
+         crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+         size--;
+      }
+
+      return crc;
+   }
+
+#ifdef E57_CRC32C_X86
+   E57_TARGET_SSE42 uint32_t crc32cSse42(uint32_t crc, const char* buf, size_t size)
+   {
+      auto p = reinterpret_cast<const uint8_t*>(buf);
+
+      uint64_t crc64 = crc;
+      while (size >= 8)
+      {
+         uint64_t word = 0;
+         memcpy(&word, p, sizeof(word));
+         crc64 = _mm_crc32_u64(crc64, word);
+
+         p += 8;
+         size -= 8;
+      }
+
+      crc = static_cast<uint32_t>(crc64);
+      while (size > 0)
+      {
+         crc = _mm_crc32_u8(crc, *p++);
+         size--;
+      }
+
+      return crc;
+   }
+
+   /// Length of each of the three streams run in parallel.  Multiples of 8.
+   /// Three short lanes fit in the 1020 byte logical part of a CheckedFile page.
+   constexpr size_t shortLaneSize = 336;
+   constexpr size_t longLaneSize = 4096;
+
+   /// x^n mod P, bit reversed like the CRC register
+   uint32_t xPowerMod(size_t n)
+   {
+      uint32_t value = 0x80000000;  // x^0
+      while (n-- > 0)
+      {
+         value = (value >> 1) ^ ((value & 1) ? crc32cPolynomial : 0);
+      }
+      return value;
+   }
+
+   /// Multiplier to shift a CRC past laneSize bytes of zeros, see shiftCrc()
+   struct ShiftConstants
+   {
+      const uint64_t shortLane = xPowerMod(8*shortLaneSize - 33);
+      const uint64_t longLane = xPowerMod(8*longLaneSize - 33);
+   };
+
+   /// Returns crc * x^(8*laneSize) mod P, given k = x^(8*laneSize - 33) mod P.
+   /// The carry-less product is a 64 bit polynomial one place off from the CRC bit order, and the
+   /// crc32 instruction reduces it mod P while multiplying by x^32, which makes up the other 33 powers.
+   E57_TARGET_SSE42_PCLMUL inline uint32_t shiftCrc(uint32_t crc, uint64_t k)
+   {
+      const __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+                                                   _mm_cvtsi64_si128(static_cast<long long>(k)), 0x00);
+
+      return static_cast<uint32_t>(_mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(product))));
+   }
+
+   /// Run three independent crc32 chains over consecutive lanes, to hide the instruction latency,
+   /// then stitch the results together.
+   E57_TARGET_SSE42_PCLMUL uint32_t crc32cLanes(uint32_t crc, const uint8_t*& p, size_t& size, size_t laneSize, uint64_t k)
+   {
+      while (size >= 3*laneSize)
+      {
+         uint64_t crc0 = crc;
+         uint64_t crc1 = 0;
+         uint64_t crc2 = 0;
+
+         for (const uint8_t* end = p + laneSize; p < end; p += 8)
+         {
+            uint64_t word0 = 0;
+            uint64_t word1 = 0;
+            uint64_t word2 = 0;
+            memcpy(&word0, p, sizeof(word0));
+            memcpy(&word1, p + laneSize, sizeof(word1));
+            memcpy(&word2, p + 2*laneSize, sizeof(word2));
+
+            crc0 = _mm_crc32_u64(crc0, word0);
+            crc1 = _mm_crc32_u64(crc1, word1);
+            crc2 = _mm_crc32_u64(crc2, word2);
+         }
+
+         crc = shiftCrc(shiftCrc(static_cast<uint32_t>(crc0), k) ^ static_cast<uint32_t>(crc1), k) ^ static_cast<uint32_t>(crc2);
+
+         p += 2*laneSize;
+         size -= 3*laneSize;
+      }
+
+      return crc;
+   }
+
+   E57_TARGET_SSE42_PCLMUL uint32_t crc32cSse42Pclmul(uint32_t crc, const char* buf, size_t size)
+   {
+      static const ShiftConstants k;
+
+      auto p = reinterpret_cast<const uint8_t*>(buf);
+
+      crc = crc32cLanes(crc, p, size, longLaneSize, k.longLane);
+      crc = crc32cLanes(crc, p, size, shortLaneSize, k.shortLane);
+
+      return crc32cSse42(crc, reinterpret_cast<const char*>(p), size);
+   }
+#endif
+
+   CrcFunction selectCrcFunction()
+   {
+#ifdef E57_CRC32C_X86
+      bool hasSse42 = false;
+      bool hasPclmul = false;
+
+#if defined(_MSC_VER)
+      int info[4] = {};
+      __cpuid(info, 1);
+      hasSse42 = (info[2] & (1 << 20)) != 0;
+      hasPclmul = (info[2] & (1 << 1)) != 0;
+#else
+      unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+      if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+      {
+         hasSse42 = (ecx & bit_SSE4_2) != 0;
+         hasPclmul = (ecx & bit_PCLMUL) != 0;
+      }
+#endif
+
+      if (hasSse42 && hasPclmul)
+      {
+         return crc32cSse42Pclmul;
+      }
+
+      if (hasSse42)
+      {
+         return crc32cSse42;
+      }
+#endif
+
+      return crc32cSoftware;
+   }
+}
+
+uint32_t e57::crc32c(const char* buf, size_t size)
+{
+   static const CrcFunction crcFunction = selectCrcFunction();
+
+   return ~crcFunction(0xFFFFFFFF, buf, size);
+}
@@ -27,6 +27,7 @@
 #include <algorithm>
 #include <cstring>
 
+#include "BitUnpack.h"
 #include "Decoder.h"
 #include "E57FormatImpl.h"
 #include "ImageFileImpl.h"
@@ -35,6 +36,19 @@
 using namespace e57;
 using namespace std;
 
+namespace
+{
+   /// Records handed to unpackBits() and to the bulk SourceDestBufferImpl setters at a time, sized to stay in L1 cache
+   constexpr size_t unpackBlockSize = 256;
+
+   /// Integers up to 32 bits go through unpackBits(), which reads bytes from any address, so they can be decoded
+   /// straight from the packet.  Wider ones are read a RegisterT word at a time from inBuffer_.
+   template <typename RegisterT>
+   unsigned integerAlignment()
+   {
+      return (sizeof(RegisterT) <= sizeof(uint32_t)) ? 1 : sizeof(RegisterT);
+   }
+}
 
 shared_ptr<Decoder> Decoder::DecoderFactory(unsigned bytestreamNumber, //!!! name ok?
                                             shared_ptr<CompressedVectorNodeImpl> cVector,
@@ -225,6 +239,65 @@ size_t BitpackDecoder::inputProcess(const char* source, const size_t availableBy
 #ifdef E57_MAX_VERBOSE
    cout << "BitpackDecoder::inputprocess() called, source=" << (source ? source : "none") << " availableByteCount="<< availableByteCount << endl;
 #endif
+   /// Decoders that need their input on word boundaries always go through inBuffer_
+   if (bytesPerWord_ > 1)
+      return(inputProcessStaged(source, availableByteCount));
+
+   size_t bytesEaten = 0;
+
+   /// A record left over from the previous packet is completed from the start of this one through inBuffer_
+   if (inBufferEndByte_ > 0) {
+      bytesEaten = inputProcessStraddling(source, availableByteCount);
+
+      /// Still staged if destBuffer_ is full, or source didn't have enough to complete the record
+      if (inBufferEndByte_ > 0)
+         return(bytesEaten);
+   }
+
+   /// Decode straight from the caller's memory, inBufferFirstBit_ is the bit offset in its first byte
+   size_t endBit = (availableByteCount - bytesEaten) * 8;
+   if (endBit > inBufferFirstBit_) {
+#ifdef E57_MAX_VERBOSE
+      cout << "  decoding " << endBit - inBufferFirstBit_ << " bits in place." << endl;
+#endif
+      size_t bitsEaten = inputProcessAligned(&source[bytesEaten], inBufferFirstBit_, endBit);
+
+      bytesEaten        += (inBufferFirstBit_ + bitsEaten) / 8;
+      inBufferFirstBit_  = (inBufferFirstBit_ + bitsEaten) % 8;
+   }
+
+   /// If destBuffer_ filled up, the rest stays in the caller's packet for the next read.
+   /// Otherwise what is left is the start of a record that continues in the next packet, so stage it.
+   bool outputBlocked = destBuffer_->nextIndex() == destBuffer_->capacity() || currentRecordIndex_ >= maxRecordCount_;
+   if (!outputBlocked && bytesEaten < availableByteCount)
+      bytesEaten += inputProcessStaged(&source[bytesEaten], availableByteCount - bytesEaten);
+
+   return(bytesEaten);
+}
+
+size_t BitpackDecoder::inputProcessStraddling(const char* source, const size_t availableByteCount)
+{
+   unsigned bitsPerRecord = 0;
+   if (!fixedBitsPerRecord(bitsPerRecord))
+      return(inputProcessStaged(source, availableByteCount));
+
+   /// Only take the bytes that complete the staged record
+   size_t recordEndByte  = (inBufferFirstBit_ + bitsPerRecord + 7) / 8;
+   size_t byteCount      = (recordEndByte > inBufferEndByte_) ? min(recordEndByte - inBufferEndByte_, availableByteCount) : 0;
+
+   size_t bytesEaten = inputProcessStaged(source, byteCount);
+
+   /// If all that is left staged came from source, give it back and carry on in place from there
+   if (inBufferEndByte_ <= bytesEaten) {
+      bytesEaten       -= inBufferEndByte_;
+      inBufferEndByte_  = 0;
+   }
+
+   return(bytesEaten);
+}
+
+size_t BitpackDecoder::inputProcessStaged(const char* source, const size_t availableByteCount)
+{
    size_t bytesUnsaved = availableByteCount;
    size_t bitsEaten = 0;
    do {
@@ -261,6 +334,12 @@ size_t BitpackDecoder::inputProcess(const char* source, const size_t availableBy
       size_t firstWord = inBufferFirstBit_ / bitsPerWord_;
       size_t firstNaturalBit = firstWord * bitsPerWord_;
       size_t endBit = inBufferEndByte_ * 8;
+
+      /// After a seek() the first bit may be in a byte that hasn't arrived yet, nothing to decode.
+      if (endBit <= inBufferFirstBit_)
+      {
+         break;
+      }
 #ifdef E57_MAX_VERBOSE
       cout << "  feeding aligned decoder " << endBit - inBufferFirstBit_ << " bits." << endl;
 #endif
@@ -294,6 +373,16 @@ void BitpackDecoder::stateReset()
    inBufferEndByte_  = 0;
 }
 
+void BitpackDecoder::seek(uint64_t recordNumber, unsigned firstBit)
+{
+   /// Throw away any queued input, it belongs to the old position.
+   stateReset();
+
+   /// The next byte fed to inputProcess() will hold the first bit of recordNumber at bit position firstBit.
+   inBufferFirstBit_   = firstBit;
+   currentRecordIndex_ = recordNumber;
+}
+
 void BitpackDecoder::inBufferShiftDown()
 {
    /// Move uneaten data down to beginning of inBuffer_.
@@ -342,7 +431,7 @@ void BitpackDecoder::dump(int indent, std::ostream& os)
 //================================================================
 
 BitpackFloatDecoder::BitpackFloatDecoder(unsigned bytestreamNumber, SourceDestBuffer& dbuf, FloatPrecision precision, uint64_t maxRecordCount)
-   : BitpackDecoder(bytestreamNumber, dbuf, (precision==E57_SINGLE) ? sizeof(float) : sizeof(double), maxRecordCount),
+   : BitpackDecoder(bytestreamNumber, dbuf, 1, maxRecordCount),   // values are copied bytewise, no alignment needed
      precision_(precision)
 {
 }
@@ -389,36 +478,13 @@ size_t BitpackFloatDecoder::inputProcessAligned(const char* inbuf, const size_t
    cout << "  n:" << n << endl; //???
 #endif
 
+   /// inbuf may be the packet itself, with no particular alignment, so values are handed over as bytes
    if (precision_ == E57_SINGLE) {
-      /// Form the starting address for first data location in inBuffer
-      auto inp = reinterpret_cast<const float*>(inbuf);
-
       /// Copy floats from inbuf to destBuffer_
-      for (unsigned i=0; i < n; i++)
-      {
-         float value = *inp;
-
-#ifdef E57_MAX_VERBOSE
-         cout << "  got float value=" << value << endl;
-#endif
-         destBuffer_->setNextFloat(value);
-         inp++;
-      }
+      destBuffer_->setNextFloatBytes(inbuf, n);
    } else {  /// E57_DOUBLE precision
-      /// Form the starting address for first data location in inBuffer
-      auto inp = reinterpret_cast<const double*>(inbuf);
-
       /// Copy doubles from inbuf to destBuffer_
-      for (unsigned i=0; i < n; i++)
-      {
-         double value = *inp;
-
-#ifdef E57_MAX_VERBOSE
-         cout << "  got double value=" << value << endl;
-#endif
-         destBuffer_->setNextDouble(value);
-         inp++;
-      }
+      destBuffer_->setNextDoubleBytes(inbuf, n);
    }
 
    /// Update counts of records processed
@@ -428,6 +494,12 @@ size_t BitpackFloatDecoder::inputProcessAligned(const char* inbuf, const size_t
    return(n*8*typeSize);
 }
 
+bool BitpackFloatDecoder::fixedBitsPerRecord(unsigned& bitsPerRecord) const
+{
+   bitsPerRecord = (precision_ == E57_SINGLE) ? 8*sizeof(float) : 8*sizeof(double);
+   return(true);
+}
+
 #ifdef E57_DEBUG
 void BitpackFloatDecoder::dump(int indent, std::ostream& os)
 {
@@ -464,8 +536,8 @@ size_t BitpackStringDecoder::inputProcessAligned(const char* inbuf, const size_t
    size_t nBytesAvailable = (endBit - firstBit) >> 3;
    size_t nBytesRead = 0;
 
-   /// Loop until we've finished all the records, or ran out of input currently available
-   while (currentRecordIndex_ < maxRecordCount_ && nBytesRead < nBytesAvailable) {
+   /// Loop until we've finished all the records, filled destBuffer, or ran out of input currently available
+   while (currentRecordIndex_ < maxRecordCount_ && destBuffer_->nextIndex() < destBuffer_->capacity() && nBytesRead < nBytesAvailable) {
 #ifdef E57_MAX_VERBOSE
       cout << "read string loop1: readingPrefix=" << readingPrefix_ << " prefixLength=" << prefixLength_ << " nBytesPrefixRead="
            << nBytesPrefixRead_ << " nBytesStringRead=" << nBytesStringRead_ << endl;
@@ -561,6 +633,27 @@ size_t BitpackStringDecoder::inputProcessAligned(const char* inbuf, const size_t
    return(nBytesRead*8);
 }
 
+bool BitpackStringDecoder::fixedBitsPerRecord(unsigned& bitsPerRecord) const
+{
+   /// Strings are variable length, can't calc position of a record without decoding all previous ones.
+   bitsPerRecord = 0;
+   return(false);
+}
+
+void BitpackStringDecoder::seek(uint64_t recordNumber, unsigned firstBit)
+{
+   BitpackDecoder::seek(recordNumber, firstBit);
+
+   /// Get ready to read prefix of first string
+   readingPrefix_      = true;
+   prefixLength_       = 1;
+   memset(prefixBytes_, 0, sizeof(prefixBytes_));
+   nBytesPrefixRead_   = 0;
+   stringLength_       = 0;
+   currentString_      = "";
+   nBytesStringRead_   = 0;
+}
+
 #ifdef E57_DEBUG
 void BitpackStringDecoder::dump(int indent, std::ostream& os)
 {
@@ -586,7 +679,7 @@ void BitpackStringDecoder::dump(int indent, std::ostream& os)
 
 template <typename RegisterT>
 BitpackIntegerDecoder<RegisterT>::BitpackIntegerDecoder(bool isScaledInteger, unsigned bytestreamNumber, SourceDestBuffer& dbuf, int64_t minimum, int64_t maximum, double scale, double offset, uint64_t maxRecordCount)
-   : BitpackDecoder(bytestreamNumber, dbuf, sizeof(RegisterT), maxRecordCount),
+   : BitpackDecoder(bytestreamNumber, dbuf, integerAlignment<RegisterT>(), maxRecordCount),
      isScaledInteger_( isScaledInteger ),
      minimum_( minimum ),
      maximum_( maximum ),
@@ -640,6 +733,35 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned(const char* inbuf,
    cout << "  recordCount=" << recordCount << endl;
 #endif
 
+   /// Values up to 32 bits are unpacked a block at a time by the vector kernels, then handed to destBuffer in bulk
+   if (sizeof(RegisterT) <= sizeof(uint32_t)) {
+      uint32_t lanes[unpackBlockSize];
+      int64_t values[unpackBlockSize];
+      size_t bitPosition = firstBit;
+
+      for (size_t done = 0; done < recordCount; ) {
+         const size_t blockCount = min(recordCount - done, unpackBlockSize);
+         unpackBits(inbuf, bitPosition, bitsPerRecord_, blockCount, lanes);
+
+         if (isScaledInteger_) {
+            /// Adds minimum_, scales and offsets in one pass
+            destBuffer_->setNextScaledInt64(minimum_, lanes, blockCount, scale_, offset_);
+         } else {
+            /// Add minimum_ to each value to get back what writer originally sent
+            for (size_t i = 0; i < blockCount; i++)
+               values[i] = minimum_ + static_cast<int64_t>(lanes[i]);
+
+            destBuffer_->setNextInt64(values, blockCount);
+         }
+
+         done += blockCount;
+         bitPosition += blockCount * bitsPerRecord_;
+      }
+
+      currentRecordIndex_ += recordCount;
+      return(recordCount * bitsPerRecord_);
+   }
+
    auto inp = reinterpret_cast<const RegisterT*>(inbuf);
    unsigned wordPosition = 0;      /// The index in inbuf of the word we are currently working on.
 
@@ -654,6 +776,7 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned(const char* inbuf,
    ///  w & mask                             00000000 00000000 0HHHLLLL LLLLLLLL
 
    size_t bitOffset = firstBit;
+   int64_t values[unpackBlockSize];
 
    for (size_t i = 0; i < recordCount; i++) {
       /// Get lower word (contains at least the LSbit of the value),
@@ -695,13 +818,18 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned(const char* inbuf,
       cout << "  Storing value=" << value << endl;
 #endif
 
-      /// The parameter isScaledInteger_ determines which version of setNextInt64 gets called
-      if (isScaledInteger_)
-         destBuffer_->setNextInt64(value, scale_, offset_);
-      else
-         destBuffer_->setNextInt64(value);
+      /// Store the result in next avaiable position in the user's dest buffer, a block at a time
+      values[i % unpackBlockSize] = value;
 
-      /// Store the result in next avaiable position in the user's dest buffer
+      if (i % unpackBlockSize == unpackBlockSize - 1 || i + 1 == recordCount) {
+         const size_t blockCount = i % unpackBlockSize + 1;
+
+         /// The parameter isScaledInteger_ determines which version of setNextInt64 gets called
+         if (isScaledInteger_)
+            destBuffer_->setNextInt64(values, blockCount, scale_, offset_);
+         else
+            destBuffer_->setNextInt64(values, blockCount);
+      }
 
       /// Calc next bit alignment and which word it starts in
       bitOffset += bitsPerRecord_;
@@ -722,6 +850,13 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned(const char* inbuf,
    return(recordCount * bitsPerRecord_);
 }
 
+template <typename RegisterT>
+bool BitpackIntegerDecoder<RegisterT>::fixedBitsPerRecord(unsigned& bitsPerRecord) const
+{
+   bitsPerRecord = bitsPerRecord_;
+   return(true);
+}
+
 #ifdef E57_DEBUG
 template <typename RegisterT>
 void BitpackIntegerDecoder<RegisterT>::dump(int indent, std::ostream& os)
@@ -775,12 +910,18 @@ size_t ConstantIntegerDecoder::inputProcess(const char* source, const size_t ava
    if (static_cast<uint64_t>(count) > remainingRecordCount)
       count = static_cast<unsigned>(remainingRecordCount);
 
-   if (isScaledInteger_) {
-      for (unsigned i = 0; i < count; i++)
-         destBuffer_->setNextInt64(minimum_, scale_, offset_);
-   } else {
-      for (unsigned i = 0; i < count; i++)
-         destBuffer_->setNextInt64(minimum_);
+   int64_t values[unpackBlockSize];
+   fill_n(values, min(count, unpackBlockSize), minimum_);
+
+   for (size_t done = 0; done < count; ) {
+      const size_t blockCount = min(count - done, unpackBlockSize);
+
+      if (isScaledInteger_)
+         destBuffer_->setNextInt64(values, blockCount, scale_, offset_);
+      else
+         destBuffer_->setNextInt64(values, blockCount);
+
+      done += blockCount;
    }
    currentRecordIndex_ += count;
    return(count);
@@ -790,6 +931,18 @@ void ConstantIntegerDecoder::stateReset()
 {
 }
 
+bool ConstantIntegerDecoder::fixedBitsPerRecord(unsigned& bitsPerRecord) const
+{
+   /// We don't use any input bytes
+   bitsPerRecord = 0;
+   return(true);
+}
+
+void ConstantIntegerDecoder::seek(uint64_t recordNumber, unsigned /*firstBit*/)
+{
+   currentRecordIndex_ = recordNumber;
+}
+
 #ifdef E57_DEBUG
 void ConstantIntegerDecoder::dump(int indent, std::ostream& os)
 {
@@ -46,6 +46,8 @@ namespace e57
          virtual uint64_t    totalRecordsCompleted() = 0;
          virtual size_t      inputProcess(const char* source, const size_t count) = 0;
          virtual void        stateReset() = 0;
+         virtual bool        fixedBitsPerRecord(unsigned& bitsPerRecord) const = 0;  /// false if records are variable length
+         virtual void        seek(uint64_t recordNumber, unsigned firstBit) = 0;      /// next input byte holds firstBit of recordNumber
          unsigned            bytestreamNumber() const { return bytestreamNumber_; }
 #ifdef E57_DEBUG
          virtual void        dump(int indent = 0, std::ostream& os = std::cout) = 0;
@@ -69,6 +71,7 @@ namespace e57
          virtual size_t    inputProcessAligned(const char* inbuf, const size_t firstBit, const size_t endBit) = 0;
 
          void        stateReset() override;
+         void        seek(uint64_t recordNumber, unsigned firstBit) override;
 
 #ifdef E57_DEBUG
          void     dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -76,6 +79,8 @@ namespace e57
       protected:
          BitpackDecoder(unsigned bytestreamNumber, SourceDestBuffer& dbuf, unsigned alignmentSize, uint64_t maxRecordCount);
 
+         size_t              inputProcessStaged(const char* source, const size_t availableByteCount);
+         size_t              inputProcessStraddling(const char* source, const size_t availableByteCount);
          void                inBufferShiftDown();
 
          uint64_t            currentRecordIndex_ = 0;
@@ -98,6 +103,7 @@ namespace e57
          BitpackFloatDecoder(unsigned bytestreamNumber, SourceDestBuffer& dbuf, FloatPrecision precision, uint64_t maxRecordCount);
 
          size_t      inputProcessAligned(const char* inbuf, const size_t firstBit, const size_t endBit) override;
+         bool        fixedBitsPerRecord(unsigned& bitsPerRecord) const override;
 
 #ifdef E57_DEBUG
          void        dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -113,6 +119,8 @@ namespace e57
          BitpackStringDecoder(unsigned bytestreamNumber, SourceDestBuffer& dbuf, uint64_t maxRecordCount);
 
          size_t      inputProcessAligned(const char* inbuf, const size_t firstBit, const size_t endBit) override;
+         bool        fixedBitsPerRecord(unsigned& bitsPerRecord) const override;
+         void        seek(uint64_t recordNumber, unsigned firstBit) override;
 
 #ifdef E57_DEBUG
          void        dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -136,6 +144,7 @@ namespace e57
                                int64_t minimum, int64_t maximum, double scale, double offset, uint64_t maxRecordCount);
 
          size_t      inputProcessAligned(const char* inbuf, const size_t firstBit, const size_t endBit) override;
+         bool        fixedBitsPerRecord(unsigned& bitsPerRecord) const override;
 
 #ifdef E57_DEBUG
          void        dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -160,6 +169,8 @@ namespace e57
          uint64_t    totalRecordsCompleted() override { return currentRecordIndex_; }
          size_t      inputProcess(const char* source, const size_t availableByteCount) override;
          void        stateReset() override;
+         bool        fixedBitsPerRecord(unsigned& bitsPerRecord) const override;
+         void        seek(uint64_t recordNumber, unsigned firstBit) override;
 #ifdef E57_DEBUG
          void        dump(int indent = 0, std::ostream& os = std::cout) override;
 #endif
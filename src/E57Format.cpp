@@ -190,7 +190,9 @@ DEALINGS IN THE SOFTWARE.
 
 #include "E57FormatImpl.h"
 
+#include "CheckedFile.h"
 #include "ImageFileImpl.h"
+#include "PointBlockImpl.h"
 #include "SourceDestBufferImpl.h"
 
 using namespace e57;
@@ -1590,6 +1592,25 @@ void SourceDestBuffer::checkInvariant(bool /*doRecurse*/) const
         throw E57_EXCEPTION1(E57_ERROR_INVARIANCE_VIOLATION);
 }
 
+//! @brief Check whether PointBlock class invariant is true
+void PointBlock::checkInvariant(bool /*doRecurse*/) const
+{
+    for (size_t i = 0; i < columnCount(); i++) {
+        // Each column is found by its own path name
+        if (columnIndex(columnPathName(i)) != i)
+            throw E57_EXCEPTION1(E57_ERROR_INVARIANCE_VIOLATION);
+
+        // Numeric columns are cache line aligned, string columns hold capacity() strings
+        if (columnRepresentation(i) == E57_USTRING) {
+            if (columnData(i) != nullptr || columnStrings(i)->size() != capacity())
+                throw E57_EXCEPTION1(E57_ERROR_INVARIANCE_VIOLATION);
+        } else {
+            if (columnData(i) == nullptr || reinterpret_cast<uintptr_t>(columnData(i)) % PointBlockImpl::columnAlignment != 0)
+                throw E57_EXCEPTION1(E57_ERROR_INVARIANCE_VIOLATION);
+        }
+    }
+}
+
 /*!
 @brief   Return the NodeType of a generic Node.
 @details This function allows the actual node type to be interrogated before upcasting the handle to the actual node type (see Upcasting and Dowcasting section in Node).
@@ -2621,6 +2642,168 @@ void SourceDestBuffer::dump(int indent, std::ostream& os) const
 {}
 #endif
 
+//=====================================================================================
+/*!
+@class PointBlock
+@brief   A set of memory buffers, one per field, owned by the API and bound once to a CompressedVectorNode.
+@details
+A PointBlock holds a structure-of-arrays block of records: one array (a column) for each field of a CompressedVectorNode prototype, all with the same capacity.
+The columns are allocated and freed by the PointBlock, and each numeric column starts on a 64 byte boundary.
+
+Unlike a std::vector<SourceDestBuffer> built by the API user, the buffers describing the columns are created once, when the column is added.
+Passing a PointBlock to CompressedVectorNode::reader or CompressedVectorNode::writer binds all its columns in one step, and every following CompressedVectorReader::read() or CompressedVectorWriter::write(size_t) moves a whole block without checking path names again.
+The same PointBlock can be reused by any number of readers and writers, one after the other, as long as it outlives them.
+
+@section pointblock_invariant Class Invariant
+A class invariant is a list of statements about an object that are always true before and after any operation on the object.
+An invariant is useful for testing correct operation of an implementation.
+Statements in an invariant can involve only externally visible state, or can refer to internal implementation-specific state that is not visible to the API user.
+The following C++ code checks externally visible state for consistency and throws an exception if the invariant is violated:
+@dontinclude E57Format.cpp
+@skip begin PointBlock::checkInvariant
+@skip checkInvariant(
+@until end PointBlock::checkInvariant
+
+@see     SourceDestBuffer, CompressedVectorNode
+*/
+
+/*!
+@brief   Create an empty PointBlock, to which columns are added with PointBlock::addColumn.
+@param   [in] destImageFile The ImageFile the columns will be transferred to/from.
+@param   [in] capacity      The number of records each column can hold.
+@pre     The @a destImageFile must be open (i.e. destImageFile.isOpen() must be true).
+@pre     capacity > 0
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     PointBlock::addColumn
+*/
+PointBlock::PointBlock(ImageFile destImageFile, size_t capacity)
+: impl_(new PointBlockImpl(destImageFile.impl(), capacity))
+{
+}
+
+/*!
+@brief   Create a PointBlock with a column for every field of a CompressedVectorNode's prototype.
+@param   [in] cv        The CompressedVectorNode whose prototype gives the columns.
+@param   [in] capacity  The number of records each column can hold.
+@details
+Columns are added in prototype order, named by their path name relative to the prototype (e.g. "cartesianX", "colors/0").
+Each one uses the memory representation that holds the field's values exactly:
+IntegerNode fields get an ::E57_INT64 column, ScaledIntegerNode fields an ::E57_REAL64 column of scaled values, FloatNode fields an ::E57_REAL32 or ::E57_REAL64 column to match the precision, and StringNode fields a ::E57_USTRING column.
+More columns can't usefully be added afterwards, as the prototype has no fields left for them.
+
+@pre     The destination ImageFile must be open (i.e. cv.destImageFile().isOpen()).
+@pre     capacity > 0
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     CompressedVectorNode::prototype, CompressedVectorNode::reader(const PointBlock&), CompressedVectorNode::writer(PointBlock&)
+*/
+PointBlock::PointBlock(const CompressedVectorNode& cv, size_t capacity)
+: impl_(new PointBlockImpl(cv.impl()->destImageFile(), capacity))
+{
+    impl_->addPrototypeColumns(cv.impl()->getPrototype());
+}
+
+/*!
+@brief   Add a column for one field of a CompressedVectorNode.
+@param   [in] pathName          The pathname of the field in the CompressedVectorNode prototype, as for SourceDestBuffer::SourceDestBuffer.
+@param   [in] representation    The type of the column elements.
+@param   [in] doConversion      Will a conversion be attempted between memory and ImageFile representations.
+@param   [in] doScaling         In a ScaledInteger field, do memory elements hold scaled values, if false they hold raw values.
+@details
+The column is allocated with capacity() elements, set to zero (or to empty strings).
+See SourceDestBuffer::doConversion and SourceDestBuffer::doScaling for the meaning of @a doConversion and @a doScaling.
+@return  The index of the new column.
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+@throw   ::E57_ERROR_BAD_PATH_NAME
+@throw   ::E57_ERROR_BUFFER_DUPLICATE_PATHNAME
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     PointBlock::columnData, PointBlock::columnStrings
+*/
+size_t PointBlock::addColumn(const ustring& pathName, MemoryRepresentation representation, bool doConversion, bool doScaling)
+{
+    return impl_->addColumn(pathName, representation, doConversion, doScaling);
+}
+
+//! @brief   Get the number of records each column can hold.
+//! @post    No visible state is modified.
+size_t PointBlock::capacity() const
+{
+    return impl_->capacity();
+}
+
+//! @brief   Get the number of columns.
+//! @post    No visible state is modified.
+size_t PointBlock::columnCount() const
+{
+    return impl_->columnCount();
+}
+
+/*!
+@brief   Get the index of the column with the given path name.
+@param   [in] pathName  The path name exactly as the column was added with.
+@post    No visible state is modified.
+@throw   ::E57_ERROR_PATH_UNDEFINED
+*/
+size_t PointBlock::columnIndex(const ustring& pathName) const
+{
+    return impl_->columnIndex(pathName);
+}
+
+//! @brief   Get the path name of column @a index.
+//! @post    No visible state is modified.
+//! @throw   ::E57_ERROR_BAD_API_ARGUMENT
+ustring PointBlock::columnPathName(size_t index) const
+{
+    return impl_->columnPathName(index);
+}
+
+//! @brief   Get the memory representation of column @a index.
+//! @post    No visible state is modified.
+//! @throw   ::E57_ERROR_BAD_API_ARGUMENT
+MemoryRepresentation PointBlock::columnRepresentation(size_t index) const
+{
+    return impl_->columnRepresentation(index);
+}
+
+/*!
+@brief   Get the first element of numeric column @a index.
+@details
+The elements are stored back to back, with the type given by columnRepresentation(), and the array starts on a 64 byte boundary.
+The pointer stays valid for the life of the PointBlock.
+@return  Address of the column's first element, or nullptr for an ::E57_USTRING column.
+@post    No visible state is modified.
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+*/
+void* PointBlock::columnData(size_t index) const
+{
+    return impl_->columnData(index);
+}
+
+//! @brief   Get the strings of ::E57_USTRING column @a index.
+//! @return  The column's capacity() strings, or nullptr for a numeric column.
+//! @post    No visible state is modified.
+//! @throw   ::E57_ERROR_BAD_API_ARGUMENT
+std::vector<ustring>* PointBlock::columnStrings(size_t index) const
+{
+    return impl_->columnStrings(index);
+}
+
+//! @brief   Diagnostic function to print internal state of object to output stream in an indented format.
+//! @copydetails Node::dump()
+#ifdef E57_DEBUG
+void PointBlock::dump(int indent, std::ostream& os) const
+{
+    impl_->dump(indent, os);
+}
+#else
+void PointBlock::dump(int indent, std::ostream& os) const
+{}
+#endif
+
 //=====================================================================================
 /*!
 @class CompressedVectorReader
@@ -2750,6 +2933,8 @@ unsigned CompressedVectorReader::read(std::vector<SourceDestBuffer>& dbufs)
 This function may be called at any time (as long as ImageFile and CompressedVectorReader are open).
 The next read will start at the given recordNumber.
 It is not an error to seek to recordNumber = childCount() (i.e. to one record past end of CompressedVectorNode).
+If the CompressedVectorNode binary section has index packets they are used to find the record, otherwise the data packet headers are scanned once on the first seek.
+Records containing StringNode fields are variable length, so in that case only a seek to recordNumber = 0 is supported.
 
 @pre     @a recordNumber <= childCount() of CompressedVectorNode.
 @pre     The associated ImageFile must be open.
@@ -2757,6 +2942,7 @@ It is not an error to seek to recordNumber = childCount() (i.e. to one record pa
 @throw   ::E57_ERROR_BAD_API_ARGUMENT
 @throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
 @throw   ::E57_ERROR_READER_NOT_OPEN
+@throw   ::E57_ERROR_NOT_IMPLEMENTED    Seek to non-zero @a recordNumber when a destination buffer is reading a StringNode
 @throw   ::E57_ERROR_BAD_CV_PACKET
 @throw   ::E57_ERROR_LSEEK_FAILED
 @throw   ::E57_ERROR_READ_FAILED
@@ -3277,6 +3463,8 @@ CompressedVectorWriter CompressedVectorNode::writer(std::vector<SourceDestBuffer
 The pathNames in the @a dbufs must identify terminal nodes (i.e. node that can have no children: IntegerNode, ScaledIntegerNode, FloatNode, StringNode) in this CompressedVectorNode's prototype.
 It is an error for two SourceDestBuffers in @a dbufs to identify the same terminal node in the prototype.
 It is not an error to create a CompressedVectorReader for an empty CompressedVectorNode.
+Several CompressedVectorReader objects can be open on an ImageFile at the same time, for the same or different CompressedVectorNodes.
+They share the packets they read (see ImageFile::setPacketCacheSize), and once created each one can call CompressedVectorReader::read and CompressedVectorReader::seek on its own thread, at the same time as the others.
 
 @pre     @a dbufs can't be empty
 @pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
@@ -3299,6 +3487,38 @@ CompressedVectorReader CompressedVectorNode::reader(const std::vector<SourceDest
     return CompressedVectorReader(impl_->reader(dbufs));
 }
 
+/*!
+@brief   Create an iterator object for writing a series of blocks of data from the columns of a PointBlock.
+@param   [in] block     The columns that will hold data to be written to this CompressedVectorNode.
+@details
+Same as CompressedVectorNode::writer(std::vector<SourceDestBuffer>&) with the buffers describing the columns of @a block, which are checked against the prototype here, once.
+Fill the columns and call CompressedVectorWriter::write(size_t) for each block of records; the columns are not looked up again.
+The @a block must outlive the returned CompressedVectorWriter.
+@return  A smart CompressedVectorWriter handle referencing the underlying iterator object.
+@throw   Same as CompressedVectorNode::writer(std::vector<SourceDestBuffer>&)
+@see     PointBlock, PointBlock::PointBlock(const CompressedVectorNode&, size_t)
+*/
+CompressedVectorWriter CompressedVectorNode::writer(PointBlock& block)
+{
+    return CompressedVectorWriter(impl_->writer(block.impl()->buffers()));
+}
+
+/*!
+@brief   Create an iterator object for reading a series of blocks of data into the columns of a PointBlock.
+@param   [in] block     The columns that will receive data read from this CompressedVectorNode.
+@details
+Same as CompressedVectorNode::reader(const std::vector<SourceDestBuffer>&) with the buffers describing the columns of @a block, which are checked against the prototype here, once.
+Each call of CompressedVectorReader::read() then fills the columns with the next block of records without looking them up again.
+The @a block must outlive the returned CompressedVectorReader.
+@return  A smart CompressedVectorReader handle referencing the underlying iterator object.
+@throw   Same as CompressedVectorNode::reader(const std::vector<SourceDestBuffer>&)
+@see     PointBlock, PointBlock::PointBlock(const CompressedVectorNode&, size_t)
+*/
+CompressedVectorReader CompressedVectorNode::reader(const PointBlock& block)
+{
+    return CompressedVectorReader(impl_->reader(block.impl()->buffers()));
+}
+
 //=====================================================================================
 /*!
 @class IntegerNode
@@ -4515,7 +4735,7 @@ For maximum portability, it is recommended that '/' be used as a directory separ
 Special device file name support are implementation dependent (e.g. "\\.\PhysicalDrive3" or "/dev/hd3").
 It is recommended that files that meet all of the requirements for a legal ASTM E57 file format use the extension @c ".e57".
 It is recommended that files that utilize the low-level E57 element data types, but do not have all the required element names required by ASTM E57 file format standard use the file extension @c "._e57".
-@param   [in] mode Either "w" for writing or "r" for reading.
+@param   [in] mode Either "w" for writing, "r" for reading, or "rl" for reading lazily.
 @param   [in] checksumPolicy The percentage of checksums we compute and verify as an int. Clamped to 0-100.
 @details
 
@@ -4532,6 +4752,13 @@ Read mode files may be shared.
 Write API operations are not legal for an ImageFile opened in read mode (i.e. the ImageFile is read-only).
 There is no API support for appending data onto an existing E57 data file.
 
+@par Lazy Read Mode
+In "rl" mode the XML section is only skimmed when the file is opened, noting where each element with children is.
+The children of a StructureNode or VectorNode are read from the file the first time the node is asked about them, so opening a file with a large XML section and using only a few nodes of it is much faster.
+The XML is always read with the built-in parser in this mode, and errors in the part not yet read (::E57_ERROR_XML_PARSER, ::E57_ERROR_BAD_XML_FORMAT) are only found, and thrown, when it is read.
+The children of CompressedVectorNode prototypes and codecs are read along with the CompressedVectorNode.
+Otherwise the ImageFile behaves as in read mode.
+
 @post    Resulting ImageFile is in @c open state if constructor succeeds (no exception thrown).
 @return  A smart ImageFile handle referencing the underlying object.
 @throw   ::E57_ERROR_BAD_API_ARGUMENT
@@ -4692,6 +4919,153 @@ int ImageFile::readerCount() const
     return impl_->readerCount();
 }
 
+/*!
+@brief   Set how many binary section packets the CompressedVectorReader objects of this ImageFile may keep in memory.
+@param   [in] packetCount   The maximum number of packets cached, each one 64 KiB. The default is 32.
+@details
+The CompressedVectorReader objects of an ImageFile share a cache of recently read packets.
+Bytestreams that run at different rates don't have to read the same packet again, and a packet read (and checksum verified) by one reader is available to the others.
+Memory for a packet is only allocated when it is first needed.
+A CompressedVectorNode with many fields in its prototype, or many readers used at once, may benefit from more packets, while a program short of memory can use fewer.
+Packets in use by a reader at the time are kept even if that goes over the limit, until they are released.
+Only affects CompressedVectorReader objects created after the call.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@pre     packetCount > 0
+@post    packetCacheSize() == packetCount
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::packetCacheSize, CompressedVectorNode::reader
+*/
+void ImageFile::setPacketCacheSize(unsigned packetCount)
+{
+    impl_->setPacketCacheSize(packetCount);
+}
+
+/*!
+@brief   Get the number of binary section packets a CompressedVectorReader of this ImageFile may keep in memory.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    No visible state is modified.
+@return  The maximum number of packets cached for CompressedVectorReader objects created from now on.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::setPacketCacheSize
+*/
+unsigned ImageFile::packetCacheSize() const
+{
+    return impl_->packetCacheSize();
+}
+
+/*!
+@brief   Set how many data packets each CompressedVectorReader of this ImageFile reads ahead on a background thread.
+@param   [in] packetCount   The number of data packets to read ahead of the one being decoded. The default, 0, turns this off.
+@details
+Normally a CompressedVectorReader only reads the next packet from disk once it has used up the current one, so decoding waits for each read.
+With @a packetCount > 0 each reader gets a thread that reads, and verifies the checksums of, the packets following the current one into the packet cache while the current one is being decoded.
+This mostly helps with slow (e.g. spinning or network) disks.
+At most one less than packetCacheSize() packets are read ahead, so the read ahead packets don't push out the ones being decoded.
+Only affects CompressedVectorReader objects created after the call.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    packetPrefetchCount() == packetCount
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::packetPrefetchCount, ImageFile::setPacketCacheSize, CompressedVectorNode::reader
+*/
+void ImageFile::setPacketPrefetchCount(unsigned packetCount)
+{
+    impl_->setPacketPrefetchCount(packetCount);
+}
+
+/*!
+@brief   Get how many data packets each CompressedVectorReader of this ImageFile reads ahead on a background thread.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    No visible state is modified.
+@return  The number of data packets read ahead by CompressedVectorReader objects created from now on, 0 if off.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::setPacketPrefetchCount
+*/
+unsigned ImageFile::packetPrefetchCount() const
+{
+    return impl_->packetPrefetchCount();
+}
+
+/*!
+@brief   Set how many threads the CompressedVectorWriter and CompressedVectorReader objects of this ImageFile use to encode and decode their bytestreams.
+@param   [in] threadCount   Number of threads, including the one calling CompressedVectorWriter::write or CompressedVectorReader::read. The default, 1, does all the work on the calling thread.
+@details
+Each field of the prototype of a CompressedVectorNode is encoded into its own bytestream, independently of the others until the results are put together into data packets.
+With @a threadCount > 1 a CompressedVectorWriter::write encodes the bytestreams of a packet concurrently, and waits for all of them before writing the packet.
+Likewise a CompressedVectorReader::read decodes each of its SourceDestBuffer objects on its own, from the data packets held in the packet cache, and returns when all are full.
+As the bytestreams then drift a few packets apart, the cache should have room for all the packets a read spans (see ImageFile::setPacketCacheSize).
+If the SourceDestBuffers are the fields of one array of structures (same stride, all within the first element), they are encoded from and decoded into internal columns of their own, which are copied to or from the structures a few kilobytes of them at a time.
+That way the threads don't store into the same cache lines, at the cost of memory for a second copy of the buffers.
+This helps prototypes with several fields, with large numbers of records per write or read.
+The file written, and the values read, are exactly the same whatever the number of threads.
+The threads are shared by all the writers and readers of the ImageFile.
+Only affects CompressedVectorWriter and CompressedVectorReader objects created after the call.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@pre     threadCount > 0
+@post    codecThreadCount() == threadCount
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::codecThreadCount, CompressedVectorNode::writer, CompressedVectorNode::reader
+*/
+void ImageFile::setCodecThreadCount(unsigned threadCount)
+{
+    impl_->setCodecThreadCount(threadCount);
+}
+
+/*!
+@brief   Get how many threads the CompressedVectorWriter and CompressedVectorReader objects of this ImageFile use to encode and decode their bytestreams.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    No visible state is modified.
+@return  The number of threads used by CompressedVectorWriter and CompressedVectorReader objects created from now on, 1 if only the calling thread.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::setCodecThreadCount
+*/
+unsigned ImageFile::codecThreadCount() const
+{
+    return impl_->codecThreadCount();
+}
+
+/*!
+@brief   Set whether the CompressedVectorWriter objects of this ImageFile write index packets.
+@param   [in] enable    True (the default) to write index packets, false to leave them out.
+@details
+A CompressedVectorWriter normally cuts its data packets where every bytestream starts afresh at the same record, and on close() writes index packets pointing at those places after the data packets.
+CompressedVectorReader::seek uses them to go straight to the packets holding a record.
+Prototypes with string fields are never indexed.
+Releases of this library up to 2.0.x reject files with index packets (E57_ERROR_BAD_CV_PACKET), even when reading straight through.
+Turn this off to write files for them; seeking in such files still works, after a scan of the data packet headers.
+Only affects CompressedVectorWriter objects created after the call.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    indexPacketsEnabled() == enable
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::indexPacketsEnabled, CompressedVectorNode::writer, CompressedVectorReader::seek
+*/
+void ImageFile::setIndexPacketsEnabled(bool enable)
+{
+    impl_->setIndexPacketsEnabled(enable);
+}
+
+/*!
+@brief   Get whether the CompressedVectorWriter objects of this ImageFile write index packets.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    No visible state is modified.
+@return  True if CompressedVectorWriter objects created from now on write index packets.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::setIndexPacketsEnabled
+*/
+bool ImageFile::indexPacketsEnabled() const
+{
+    return impl_->indexPacketsEnabled();
+}
+
 /*!
 @brief   Declare the use of an E57 extension in an ImageFile being written.
 @param   [in] prefix    The shorthand name of the extension to use in element names.
@@ -4909,3 +5283,18 @@ ImageFile::ImageFile(ImageFileImplSharedPtr imfi)
 {}
 //! @endcond
 
+/*!
+@brief   Set number of threads used to verify checksums when reading large ranges of an ImageFile.
+@param   [in] threadCount   Number of threads, including the one doing the read. 1 (the default) verifies every checksum on the reading thread.
+@details
+Checksums of each 1 KiB page of a file are independent, so a large read (such as a whole data packet or blob) can have them verified in parallel.
+The threads are shared by all ImageFiles, and are only used for pages checked according to the ReadChecksumPolicy of the ImageFile.
+This function should not be called while another thread is reading an ImageFile; reads already in progress keep using the previous threads until they finish.
+@post    Reads started after this call use @a threadCount threads to verify checksums.
+@throw   No E57Exceptions
+@see     ReadChecksumPolicy, ImageFile::ImageFile
+*/
+void e57::setChecksumThreadCount(unsigned threadCount)
+{
+    CheckedFile::setChecksumThreadCount(threadCount);
+}
@@ -26,7 +26,9 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 
 #include "E57FormatImpl.h"
@@ -35,7 +37,10 @@
 #include "Decoder.h"
 #include "Encoder.h"
 #include "ImageFileImpl.h"
+#include "Interleave.h"
+#include "PointBlockImpl.h"
 #include "SourceDestBufferImpl.h"
+#include "WorkerPool.h"
 
 
 using namespace e57;
@@ -48,6 +53,65 @@ enum
    COMPRESSED_VECTOR_SECTION,
 };
 
+/// Writer only starts chunks on record numbers that are a multiple of this.
+/// Any number of records times any bitsPerRecord then fills a whole number of 64 bit words, so no encoder has bits left in its register.
+constexpr uint64_t CHUNK_RECORD_ALIGNMENT = 64;
+
+/// Fewest bytes of output a writer batch is expected to produce to be worth encoding the bytestreams on several threads
+constexpr size_t MIN_PARALLEL_ENCODE_BYTES = 8*1024;
+
+/// Fewest records a reader's buffers must hold to be worth decoding the channels on several threads
+constexpr size_t MIN_PARALLEL_DECODE_RECORDS = 1024;
+
+/// True if bufs are the fields of one array of records (e.g. an array of structs holding x, y, z and intensity):
+/// all numeric, with the same stride, none of them contiguous, all starting within the first record.
+static bool isInterleaved(const vector<SourceDestBuffer>& bufs)
+{
+    if (bufs.size() < 2)
+        return false;
+
+    const size_t stride = bufs.at(0).stride();
+    uintptr_t lowest = UINTPTR_MAX;
+    uintptr_t highest = 0;
+
+    for (auto &buf : bufs) {
+        const size_t size = PointBlockImpl::elementSize(buf.memoryRepresentation());
+        if (size == 0 || buf.stride() != stride || stride == size)
+            return false;
+
+        const uintptr_t field = reinterpret_cast<uintptr_t>(buf.impl()->base());
+        lowest = min(lowest, field);
+        highest = max(highest, field + size);
+    }
+
+    return highest - lowest <= stride;
+}
+
+/// Contiguous columns with the same path names, representations and options as bufs
+static unique_ptr<PointBlockImpl> interleaveColumns(ImageFileImplWeakPtr imf, const vector<SourceDestBuffer>& bufs)
+{
+    unique_ptr<PointBlockImpl> columns(new PointBlockImpl(imf, bufs.at(0).capacity()));
+
+    for (auto &buf : bufs)
+        columns->addColumn(buf.pathName(), buf.memoryRepresentation(), buf.doConversion(), buf.doScaling());
+
+    return columns;
+}
+
+/// Pair each of bufs with its column
+static vector<InterleavedField> interleavedFields(const vector<SourceDestBuffer>& bufs, const PointBlockImpl& columns)
+{
+    vector<InterleavedField> fields(bufs.size());
+
+    for (size_t i = 0; i < bufs.size(); i++) {
+        fields[i].record = static_cast<char*>(bufs[i].impl()->base());
+        fields[i].column = static_cast<char*>(columns.columnData(i));
+        fields[i].size = PointBlockImpl::elementSize(bufs[i].memoryRepresentation());
+    }
+
+    return fields;
+}
+
 struct BlobSectionHeader
 {
     const uint8_t     sectionId = BLOB_SECTION;
@@ -135,6 +199,8 @@ bool VectorNodeImpl::allowHeteroChildren() const
 void VectorNodeImpl::set(int64_t index64, NodeImplSharedPtr ni)
 {
     checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+    materialize();
+
     if (!allowHeteroChildren_) {
         /// New node type must match all existing children
         for ( auto &child : children_ )
@@ -153,6 +219,7 @@ void VectorNodeImpl::set(int64_t index64, NodeImplSharedPtr ni)
 void VectorNodeImpl::writeXml(ImageFileImplSharedPtr imf, CheckedFile& cf, int indent, const char* forcedFieldName)
 {
     /// don't checkImageFileOpen
+    materialize();
 
     ustring fieldName;
     if (forcedFieldName != nullptr)
@@ -172,6 +239,7 @@ void VectorNodeImpl::writeXml(ImageFileImplSharedPtr imf, CheckedFile& cf, int i
 void VectorNodeImpl::dump(int indent, ostream& os) const
 {
     /// don't checkImageFileOpen
+    const_cast<VectorNodeImpl*>(this)->materialize();
     os << space(indent) << "type:        Vector" << " (" << type() << ")" << endl;
     NodeImpl::dump(indent, os);
     os << space(indent) << "allowHeteroChildren: " << allowHeteroChildren() << endl;
@@ -420,19 +488,13 @@ shared_ptr<CompressedVectorReaderImpl> CompressedVectorNodeImpl::reader(vector<S
 
     ImageFileImplSharedPtr destImageFile(destImageFile_);
 
-    /// Check don't have any writers/readers open for this ImageFile
+    /// Check don't have any writers open for this ImageFile.  Any number of readers can share its packet cache.
     if (destImageFile->writerCount() > 0) {
         throw E57_EXCEPTION2(E57_ERROR_TOO_MANY_WRITERS,
                              "fileName=" + destImageFile->fileName()
                              + " writerCount=" + toString(destImageFile->writerCount())
                              + " readerCount=" + toString(destImageFile->readerCount()));
     }
-    if (destImageFile->readerCount() > 0) {
-        throw E57_EXCEPTION2(E57_ERROR_TOO_MANY_READERS,
-                             "fileName=" + destImageFile->fileName()
-                             + " writerCount=" + toString(destImageFile->writerCount())
-                             + " readerCount=" + toString(destImageFile->readerCount()));
-    }
 
     /// dbufs can't be empty
     if (dbufs.empty())
@@ -1135,8 +1197,7 @@ void BlobNodeImpl::read(uint8_t* buf, int64_t start, size_t count)
     }
 
     ImageFileImplSharedPtr imf(destImageFile_);
-    imf->file_->seek(binarySectionLogicalStart_ + sizeof(BlobSectionHeader) + start);
-    imf->file_->read(reinterpret_cast<char*>(buf), static_cast<size_t>(count));  //??? arg1 void* ?
+    imf->file_->readAt(binarySectionLogicalStart_ + sizeof(BlobSectionHeader) + start, reinterpret_cast<char*>(buf), static_cast<size_t>(count));  //??? arg1 void* ?
 }
 
 void BlobNodeImpl::write(uint8_t* buf, int64_t start, size_t count)
@@ -1297,11 +1358,21 @@ CompressedVectorWriterImpl::CompressedVectorWriterImpl(shared_ptr<CompressedVect
     /// Check sbufs well formed (matches proto exactly)
     setBuffers(sbufs); //??? copy code here?
 
+    /// With several threads, interleaved records are copied into contiguous columns once by write(), and each bytestream
+    /// is encoded from its own column instead of every thread reading through all the records.
+    if (cVector_->destImageFile()->codecPool() && isInterleaved(sbufs_))
+        interleaveColumns_ = interleaveColumns(cVector_->destImageFile_, sbufs_);
+
+    const vector<SourceDestBuffer>& encodeBufs = interleaveColumns_ ? interleaveColumns_->buffers() : sbufs_;
+
+    /// Can only index chunks if every record has same number of bits in each bytestream, and only if asked to
+    chunkIndexEnabled_ = cVector_->destImageFile()->indexPacketsEnabled();
+
     /// For each individual sbuf, create an appropriate Encoder based on the cVector_ attributes
     for (unsigned i=0; i < sbufs_.size(); i++) {
         /// Create vector of single sbuf  ??? for now, may have groups later
         vector<SourceDestBuffer> vTemp;
-        vTemp.push_back(sbufs_.at(i));
+        vTemp.push_back(encodeBufs.at(i));
 
         ustring codecPath = sbufs_.at(i).pathName();
 
@@ -1311,6 +1382,9 @@ CompressedVectorWriterImpl::CompressedVectorWriterImpl(shared_ptr<CompressedVect
         if (!proto_->findTerminalPosition(readNode, bytestreamNumber))
             throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "sbufIndex=" + toString(i));
 
+        if (readNode->type() == E57_STRING)
+            chunkIndexEnabled_ = false;
+
         /// EncoderFactory picks the appropriate encoder to match type declared in prototype
         bytestreams_.push_back(Encoder::EncoderFactory(static_cast<unsigned>(bytestreamNumber), cVector_, vTemp, codecPath));
     }
@@ -1330,10 +1404,16 @@ CompressedVectorWriterImpl::CompressedVectorWriterImpl(shared_ptr<CompressedVect
 
     ImageFileImplSharedPtr imf(ni->destImageFile_);
 
+    /// Threads to encode bytestreams on, null if only this one
+    encodePool_ = imf->codecPool();
+
     /// Reserve space for CompressedVector binary section header, record location so can save to when writer closes.
     /// Request that file be extended with zeros since we will write to it at a later time (when writer closes).
     sectionHeaderLogicalStart_ = imf->allocateSpace(sizeof(CompressedVectorSectionHeader), true);
 
+    /// Let another thread checksum and write the data packets to disk while we encode the following ones
+    imf->file_->setBackgroundWrite(true);
+
     sectionLogicalLength_   = 0;
     dataPhysicalOffset_     = 0;
     topIndexPhysicalOffset_ = 0;
@@ -1341,6 +1421,10 @@ CompressedVectorWriterImpl::CompressedVectorWriterImpl(shared_ptr<CompressedVect
     dataPacketsCount_       = 0;
     indexPacketsCount_      = 0;
 
+    /// First data packet starts the first chunk
+    chunkStartPending_      = chunkIndexEnabled_;
+    chunkStartRecordNumber_ = 0;
+
     /// Just before return (and can't throw) increment writer count  ??? safer way to assure don't miss close?
     imf->incrWriterCount();
 
@@ -1390,6 +1474,9 @@ void CompressedVectorWriterImpl::close()
         flush();
     }
 
+    /// Write index packets after the data packets, if have more than one chunk to point at
+    topIndexPhysicalOffset_ = indexPacketsWrite();
+
     /// Compute length of whole section we just wrote (from section start to current start of free space).
     sectionLogicalLength_ = imf->unusedLogicalStart_ - sectionHeaderLogicalStart_;
 #ifdef E57_MAX_VERBOSE
@@ -1400,7 +1487,7 @@ void CompressedVectorWriterImpl::close()
     CompressedVectorSectionHeader header;
     header.sectionLogicalLength = sectionLogicalLength_;
     header.dataPhysicalOffset   = dataPhysicalOffset_;   ///??? can be zero, if no data written ???not set yet
-    header.indexPhysicalOffset  = topIndexPhysicalOffset_;  ///??? can be zero, if no data written ???not set yet
+    header.indexPhysicalOffset  = topIndexPhysicalOffset_;  /// zero if no index packets written
 #ifdef E57_MAX_VERBOSE
     cout << "  CompressedVectorSectionHeader:" << endl;
     header.dump(4); //???
@@ -1414,6 +1501,9 @@ void CompressedVectorWriterImpl::close()
     imf->file_->seek(sectionHeaderLogicalStart_);
     imf->file_->write(reinterpret_cast<char*>(&header), sizeof(header));
 
+    /// Wait for the background thread to finish, so any failure to write a packet is reported here
+    imf->file_->setBackgroundWrite(false);
+
     /// Set address and size of associated CompressedVector
     cVector_->setRecordCount(recordCount_);
     cVector_->setBinarySectionLogicalStart(sectionHeaderLogicalStart_);
@@ -1501,6 +1591,26 @@ void CompressedVectorWriterImpl::write(const size_t requestedRecordCount)
        sbuf.impl()->rewind();
     }
 
+    /// Copy the records into the columns the encoders read, all fields in one pass
+    if ( interleaveColumns_ )
+    {
+       for ( auto &column : interleaveColumns_->buffers() )
+       {
+          column.impl()->rewind();
+       }
+
+       gatherRecords( interleavedFields( sbufs_, *interleaveColumns_ ), sbufs_.at(0).stride(), requestedRecordCount );
+    }
+
+    /// Bits the encoders said the records processed so far would take, and the bytes they actually produced, times 8
+    double predictedBits = 0;
+    double producedBits = 0;
+
+    /// Each bytestream's record index before and after the current batch, and its estimate of bits per record
+    vector<uint64_t> batchStartIndex(bytestreams_.size());
+    vector<uint64_t> batchEndIndex(bytestreams_.size());
+    vector<float> batchBitsPerRecord(bytestreams_.size());
+
     /// Loop until all channels have completed requestedRecordCount transfers
     uint64_t endRecordIndex = recordCount_ + requestedRecordCount;
     for (;;) {
@@ -1534,41 +1644,89 @@ void CompressedVectorWriterImpl::write(const size_t requestedRecordCount)
 #else
 #  define E57_TARGET_PACKET_SIZE    (DATA_PACKET_MAX*3/4)
 #endif
-        /// If have more than target fraction of packet, send it now
-        if (currentPacketSize() >= E57_TARGET_PACKET_SIZE) {  //???
+        /// If have more than target fraction of packet, send it now.
+        /// Wait until all bytestreams reach a chunk boundary, then send everything so next packet starts a new chunk.
+        if (currentPacketSize() >= E57_TARGET_PACKET_SIZE && atChunkBoundary()) {
+            while (totalOutputAvailable() > 0)
+                packetWrite();
+
+            chunkStartPending_      = true;
+            chunkStartRecordNumber_ = bytestreams_.at(0)->currentRecordIndex();
+            continue;  /// restart loop so recalc statistics
+        }
+        if (currentPacketSize() >= E57_TARGET_PACKET_SIZE && !chunkIndexEnabled_) {
             packetWrite();
             continue;  /// restart loop so recalc statistics (packet size may not be zero after write, if have too much data)
         }
 
-        ///??? useful?
-        /// Get approximation of number of bytes per record of CompressedVector and total of bytes used
+        /// Get approximation of number of bits per record of CompressedVector, and range of records the bytestreams are at
         float totalBitsPerRecord = 0;  // an estimate of future performance
-        for ( auto &bytestream : bytestreams_ )
-        {
-            totalBitsPerRecord += bytestream->bitsPerRecord();
+        uint64_t behindRecordIndex = endRecordIndex;
+        uint64_t aheadRecordIndex = 0;
+        for (size_t i = 0; i < bytestreams_.size(); i++) {
+            batchStartIndex.at(i) = bytestreams_.at(i)->currentRecordIndex();
+            batchBitsPerRecord.at(i) = bytestreams_.at(i)->bitsPerRecord();
+
+            totalBitsPerRecord += batchBitsPerRecord.at(i);
+            behindRecordIndex = min(behindRecordIndex, batchStartIndex.at(i));
+            aheadRecordIndex = max(aheadRecordIndex, batchStartIndex.at(i));
         }
 
+        /// Correct the estimate by how far off it was for the batches so far (string lengths vary, registers hold back bits)
+        if (predictedBits > 0 && producedBits > 0)
+            totalBitsPerRecord *= static_cast<float>(min(max(producedBits / predictedBits, 0.25), 4.0));
+
 #ifdef E57_MAX_VERBOSE
         float totalBytesPerRecord = max(totalBitsPerRecord/8, 0.1F); //??? trust
 
         cout << "  totalBytesPerRecord=" << totalBytesPerRecord << endl; //???
 #endif
 
-        /// Don't allow straggler to get too far behind. ???
-        /// Don't allow a single channel to get too far ahead ???
-        /// Process channels that are furthest behind first. ???
+        /// Number of records that should bring the packet up to the target size.  If it is already there, just bring
+        /// the stragglers up to the next chunk boundary.
+        uint64_t batchRecordCount = endRecordIndex - behindRecordIndex;
+        if (totalBitsPerRecord > 0) {
+            size_t packetSize = currentPacketSize();
+            size_t roomBytes = (packetSize < E57_TARGET_PACKET_SIZE) ? E57_TARGET_PACKET_SIZE - packetSize : 0;
+            batchRecordCount = min(batchRecordCount, static_cast<uint64_t>(8*roomBytes / totalBitsPerRecord));
+        }
 
-        ///!!!! For now just process one record per loop until packet is full enough, or completed request
-        for ( auto &bytestream : bytestreams_ )
-        {
-             if (bytestream->currentRecordIndex() < endRecordIndex)
-             {
-                //!!! For now, process up to 50 records at a time
-                uint64_t recordCount = endRecordIndex - bytestream->currentRecordIndex();
-                recordCount = (recordCount<50ULL)?recordCount:50ULL; //min(recordCount, 50ULL);
-                bytestream->processRecords(static_cast<unsigned>(recordCount));
+        /// All bytestreams stop at the same multiple of CHUNK_RECORD_ALIGNMENT, so they arrive at each possible chunk boundary together
+        uint64_t stopRecordIndex = max(aheadRecordIndex, behindRecordIndex + max(batchRecordCount, static_cast<uint64_t>(1)));
+        stopRecordIndex = min(endRecordIndex, (stopRecordIndex + CHUNK_RECORD_ALIGNMENT - 1) / CHUNK_RECORD_ALIGNMENT * CHUNK_RECORD_ALIGNMENT);
+#ifdef E57_MAX_VERBOSE
+        cout << "  batchRecordCount=" << batchRecordCount << " stopRecordIndex=" << stopRecordIndex << endl; //???
+#endif
+
+        /// Drive each encoder up to stopRecordIndex in one call.  It may stop short if its output buffer fills up.
+        auto encodeRange = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                batchEndIndex.at(i) = batchStartIndex.at(i);
+                if (batchStartIndex.at(i) < stopRecordIndex)
+                    batchEndIndex.at(i) = bytestreams_.at(i)->processRecords(static_cast<size_t>(stopRecordIndex - batchStartIndex.at(i)));
             }
+        };
+
+        /// Bytestreams are independent until packetWrite() puts them together, so big batches are encoded concurrently if
+        /// turned on.  parallelFor() returns once all are done, and the results don't depend on the order they ran in.
+        size_t outputBefore = totalOutputAvailable();
+        if (encodePool_ && bytestreams_.size() > 1 && (stopRecordIndex - behindRecordIndex) * totalBitsPerRecord >= 8*MIN_PARALLEL_ENCODE_BYTES)
+            encodePool_->parallelFor(bytestreams_.size(), 1, encodeRange);
+        else
+            encodeRange(0, bytestreams_.size());
+
+        bool madeProgress = false;
+        for (size_t i = 0; i < bytestreams_.size(); i++) {
+            if (batchEndIndex.at(i) > batchStartIndex.at(i))
+                madeProgress = true;
+
+            predictedBits += static_cast<double>(batchBitsPerRecord.at(i)) * (batchEndIndex.at(i) - batchStartIndex.at(i));
         }
+        producedBits += 8.0 * (totalOutputAvailable() - outputBefore);
+
+        /// If encoder output buffers filled up before reaching a chunk boundary, have to send a packet in middle of chunk
+        if (!madeProgress)
+            packetWrite();
     }
 
     recordCount_ += requestedRecordCount;
@@ -1714,7 +1872,7 @@ uint64_t CompressedVectorWriterImpl::packetWrite()
     /// packetLength must be multiple of 4, if not, add some zero padding
     while (packetLength % 4) {
         /// Double check we aren't accidentally going to write off end of vector<char>
-        if (p >= &packet[DATA_PACKET_MAX-1])
+        if (p >= &packet[DATA_PACKET_MAX])
             throw E57_EXCEPTION1(E57_ERROR_INTERNAL);
         *p++ = 0;
         packetLength++;
@@ -1748,7 +1906,15 @@ uint64_t CompressedVectorWriterImpl::packetWrite()
         dataPhysicalOffset_ = packetPhysicalOffset;
     dataPacketsCount_++;
 
-    ///!!! update seekIndex here? if started new chunk?
+    /// If this packet starts a chunk, remember where for the index packets
+    if (chunkStartPending_) {
+        IndexPacket::IndexPacketEntry entry;
+        entry.chunkRecordNumber   = chunkStartRecordNumber_;
+        entry.chunkPhysicalOffset = packetPhysicalOffset;
+        chunkIndex_.push_back(entry);
+
+        chunkStartPending_ = false;
+    }
 
     /// Return physical offset of data packet for potential use in seekIndex
     return(packetPhysicalOffset); //??? needed
@@ -1762,6 +1928,83 @@ void CompressedVectorWriterImpl::flush()
     }
 }
 
+bool CompressedVectorWriterImpl::atChunkBoundary() const
+{
+    if (!chunkIndexEnabled_)
+        return(false);
+
+    /// All bytestreams must have processed exactly the same records, ending on an aligned record number
+    uint64_t recordIndex = bytestreams_.at(0)->currentRecordIndex();
+    if (recordIndex % CHUNK_RECORD_ALIGNMENT != 0)
+        return(false);
+
+    for ( const auto &bytestream : bytestreams_ )
+    {
+        if (bytestream->currentRecordIndex() != recordIndex)
+            return(false);
+    }
+
+    return(true);
+}
+
+uint64_t CompressedVectorWriterImpl::indexPacketsWrite()
+{
+    /// A single chunk is no help to a reader, don't bother with index
+    if (chunkIndex_.size() < 2)
+        return(0);
+
+    ImageFileImplSharedPtr imf(cVector_->destImageFile_);
+
+    /// Build tree from bottom up.  Each level's packets get an entry in the level above, until one packet is left.
+    vector<IndexPacket::IndexPacketEntry> levelEntries = chunkIndex_;
+    uint64_t topPhysicalOffset = 0;
+    for (unsigned level = 0; ; level++) {
+        /// Spread entries evenly over packets, so every packet above level 0 has at least two entries.
+        size_t packetCount = (levelEntries.size() + IndexPacket::MAX_ENTRIES - 1) / IndexPacket::MAX_ENTRIES;
+
+        vector<IndexPacket::IndexPacketEntry> parentEntries;
+        size_t first = 0;
+        for (size_t i = 0; i < packetCount; i++) {
+            size_t end = (levelEntries.size() * (i+1)) / packetCount;
+
+            /// Use temp buf on heap, IndexPacket is 32KBytes long
+            unique_ptr<IndexPacket> ipkt(new IndexPacket);
+            ipkt->entryCount = static_cast<uint16_t>(end - first);
+            ipkt->indexLevel = static_cast<uint8_t>(level);
+            for (size_t j = first; j < end; j++)
+                ipkt->entries[j - first] = levelEntries[j];
+
+            unsigned packetLength = IndexPacket::HEADER_SIZE + ipkt->entryCount*sizeof(IndexPacket::IndexPacketEntry);
+            ipkt->packetLogicalLengthMinus1 = static_cast<uint16_t>(packetLength-1);
+
+            /// Double check that index packet is well formed
+            ipkt->verify(packetLength, recordCount_);
+
+            uint64_t packetLogicalOffset = imf->allocateSpace(packetLength, false);
+            uint64_t packetPhysicalOffset = imf->file_->logicalToPhysical(packetLogicalOffset);
+            imf->file_->seek(packetLogicalOffset);
+            imf->file_->write(reinterpret_cast<char*>(ipkt.get()), packetLength);
+            indexPacketsCount_++;
+
+            /// Parent entry points at this packet, starting with its first record
+            IndexPacket::IndexPacketEntry entry;
+            entry.chunkRecordNumber   = levelEntries[first].chunkRecordNumber;
+            entry.chunkPhysicalOffset = packetPhysicalOffset;
+            parentEntries.push_back(entry);
+
+            topPhysicalOffset = packetPhysicalOffset;
+            first = end;
+        }
+
+        if (packetCount == 1)
+            break;
+
+        levelEntries.swap(parentEntries);
+    }
+
+    return(topPhysicalOffset);
+}
+
 void CompressedVectorWriterImpl::checkImageFileOpen(const char* srcFileName, int srcLineNumber, const char* srcFunctionName) const
 {
    // unimplemented...
@@ -1849,10 +2092,17 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
     /// Check dbufs well formed (matches proto exactly)
     setBuffers(dbufs);
 
+    /// With several threads, interleaved records are decoded into contiguous columns, and copied into the records by read().
+    /// Otherwise each thread would store its field into the same cache lines as the others.
+    if (cVector_->destImageFile()->codecPool() && isInterleaved(dbufs_))
+        interleaveColumns_ = interleaveColumns(cVector_->destImageFile_, dbufs_);
+
+    const vector<SourceDestBuffer>& decodeBufs = interleaveColumns_ ? interleaveColumns_->buffers() : dbufs;
+
     /// For each dbuf, create an appropriate Decoder based on the cVector_ attributes
     for (unsigned i=0; i < dbufs_.size(); i++) {
         vector<SourceDestBuffer> theDbuf;
-        theDbuf.push_back(dbufs.at(i));
+        theDbuf.push_back(decodeBufs.at(i));
 
         shared_ptr<Decoder> decoder =  Decoder::DecoderFactory(i, cVector_, theDbuf, ustring());
 
@@ -1862,7 +2112,7 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
         if (!proto_->findTerminalPosition(readNode, bytestreamNumber))
             throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "dbufIndex=" + toString(i));
 
-        channels_.emplace_back(dbufs.at(i), decoder, static_cast<unsigned>(bytestreamNumber), cVector_->childCount());
+        channels_.emplace_back(decodeBufs.at(i), decoder, static_cast<unsigned>(bytestreamNumber), cVector_->childCount());
     }
 
     recordCount_ = 0;
@@ -1873,7 +2123,10 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
     ImageFileImplSharedPtr imf(cVector_->destImageFile_);
 
     //??? what if fault in this constructor?
-    cache_ = new PacketReadCache(imf->file_, 32);
+    cache_ = imf->packetCache();
+
+    /// Threads to decode channels on, null if only this one
+    decodePool_ = imf->codecPool();
 
     /// Read CompressedVector section header
     CompressedVectorSectionHeader sectionHeader;
@@ -1884,8 +2137,7 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
                              "imageFileName=" + cVector_->imageFileName()
                              + " cvPathName=" + cVector_->pathName());
     }
-    imf->file_->seek(sectionLogicalStart, CheckedFile::Logical);
-    imf->file_->read(reinterpret_cast<char*>(&sectionHeader), sizeof(sectionHeader));
+    imf->file_->readAt(sectionLogicalStart, reinterpret_cast<char*>(&sectionHeader), sizeof(sectionHeader));
 
 #ifdef E57_DEBUG
     sectionHeader.verify(imf->file_->length(CheckedFile::Physical));
@@ -1895,12 +2147,17 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
     sectionEndLogicalOffset_ = sectionLogicalStart + sectionHeader.sectionLogicalLength;
 
     /// Convert physical offset to first data packet to logical
-    uint64_t dataLogicalOffset = imf->file_->physicalToLogical(sectionHeader.dataPhysicalOffset);
+    dataLogicalOffset_ = imf->file_->physicalToLogical(sectionHeader.dataPhysicalOffset);
+
+    /// Remember where index packets start (if any), used by seek()
+    indexLogicalOffset_ = 0;
+    if (sectionHeader.indexPhysicalOffset != 0)
+        indexLogicalOffset_ = imf->file_->physicalToLogical(sectionHeader.indexPhysicalOffset);
 
     /// Verify that packet given by dataPhysicalOffset is actually a data packet, init channels
     {
         char* anyPacket = nullptr;
-        unique_ptr<PacketLock> packetLock = cache_->lock(dataLogicalOffset, anyPacket);
+        unique_ptr<PacketLock> packetLock = cache_->lock(dataLogicalOffset_, anyPacket);
 
         auto dpkt = reinterpret_cast<DataPacket*>(anyPacket);
 
@@ -1913,12 +2170,21 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
         /// Have good packet, initialize channels
         for ( auto &channel : channels_ )
         {
-            channel.currentPacketLogicalOffset    = dataLogicalOffset;
+            channel.currentPacketLogicalOffset    = dataLogicalOffset_;
             channel.currentBytestreamBufferIndex  = 0;
             channel.currentBytestreamBufferLength = dpkt->getBytestreamBufferLength(channel.bytestreamNumber);
         }
     }
 
+    /// Read following packets on a background thread while we decode, leaving room in cache for the ones being decoded
+    const unsigned prefetchCount = std::min(imf->packetPrefetchCount(), imf->packetCacheSize() - 1);
+    if (prefetchCount > 0) {
+        prefetcher_.reset(new PacketPrefetcher(cache_, sectionEndLogicalOffset_, prefetchCount));
+
+        /// ImageFile has to stop it if closed before we are
+        imf->addPrefetcher(prefetcher_.get());
+    }
+
     /// Just before return (and can't throw) increment reader count  ??? safer way to assure don't miss close?
     imf->incrReaderCount();
 
@@ -1998,6 +2264,14 @@ unsigned CompressedVectorReaderImpl::read()
        dbuf.impl()->rewind();
     }
 
+    if ( interleaveColumns_ )
+    {
+       for ( auto &column : interleaveColumns_->buffers() )
+       {
+          column.impl()->rewind();
+       }
+    }
+
     /// Allow decoders to use data they already have in their queue to fill newly empty dbufs
     /// This helps to keep decoder input queues smaller, which reduces backtracking in the packet cache.
     for ( auto &channel : channels_ )
@@ -2005,6 +2279,16 @@ unsigned CompressedVectorReaderImpl::read()
        channel.decoder->inputProcess( nullptr, 0 );
     }
 
+    /// With several threads, let each channel work through the packets on its own.
+    /// Packets are only read, and each channel keeps the one it is decoding locked in the cache, so they don't interfere.
+    if (decodePool_ && channels_.size() > 1 && channels_[0].dbuf.impl()->capacity() >= MIN_PARALLEL_DECODE_RECORDS)
+    {
+        decodePool_->parallelFor(channels_.size(), 1, [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                feedPacketsToChannel(channels_[i]);
+        });
+    }
+
     /// Loop until every dbuf is full or we have reached end of the binary section.
     while (true)
     {
@@ -2040,6 +2324,10 @@ unsigned CompressedVectorReaderImpl::read()
         }
     }
 
+    /// Copy the columns into the caller's records, all fields in one pass
+    if (interleaveColumns_)
+        scatterRecords(interleavedFields(dbufs_, *interleaveColumns_), dbufs_.at(0).stride(), outputCount);
+
     /// Return number of records transferred to each dbuf.
     return outputCount;
 }
@@ -2078,11 +2366,12 @@ uint64_t CompressedVectorReaderImpl::earliestPacketNeededForInput() const
     return earliestPacketLogicalOffset;
 }
 
-DataPacket *CompressedVectorReaderImpl::dataPacket( uint64_t inLogicalOffset ) const
+DataPacket *CompressedVectorReaderImpl::dataPacket( uint64_t inLogicalOffset, unique_ptr<PacketLock> &packetLock ) const
 {
    char  *packet = nullptr;
 
-   unique_ptr<PacketLock> packetLock = cache_->lock( inLogicalOffset, packet );
+   /// Packet stays in cache as long as caller holds on to the lock
+   packetLock = cache_->lock( inLogicalOffset, packet );
 
    return reinterpret_cast<DataPacket*>( packet );
 }
@@ -2093,8 +2382,15 @@ void CompressedVectorReaderImpl::feedPacketToDecoders( uint64_t currentPacketLog
    bool     channelHasExhaustedPacket = false;
    uint64_t nextPacketLogicalOffset = E57_UINT64_MAX;
 
+   /// Let background thread get on with the packets after this one
+   if ( prefetcher_ )
+   {
+      prefetcher_->ahead( currentPacketLogicalOffset );
+   }
+
    /// Get packet at currentPacketLogicalOffset into memory.
-   auto dpkt = dataPacket( currentPacketLogicalOffset );
+   unique_ptr<PacketLock> packetLock;
+   auto dpkt = dataPacket( currentPacketLogicalOffset, packetLock );
 
    /// Double check that have a data packet.  Should have already determined this.
    if ( dpkt->header.packetType != DATA_PACKET )
@@ -2170,7 +2466,7 @@ void CompressedVectorReaderImpl::feedPacketToDecoders( uint64_t currentPacketLog
      if ( nextPacketLogicalOffset < E57_UINT64_MAX )
      { //??? huh?
          /// Get packet at nextPacketLogicalOffset into memory.
-         dpkt = dataPacket( nextPacketLogicalOffset );
+         dpkt = dataPacket( nextPacketLogicalOffset, packetLock );
 
          /// Got a data packet, update the channels with exhausted input
          for ( DecodeChannel &channel : channels_ )
@@ -2213,6 +2509,55 @@ void CompressedVectorReaderImpl::feedPacketToDecoders( uint64_t currentPacketLog
    }
 }
 
+void CompressedVectorReaderImpl::feedPacketsToChannel(DecodeChannel& channel)
+{
+    /// Same as feedPacketToDecoders(), but for one channel at a time, going from packet to packet until it is full.
+    /// Only touches channel, so can run on several channels at once.
+    while (!channel.isOutputBlocked() && !channel.inputFinished)
+    {
+        const uint64_t currentPacketLogicalOffset = channel.currentPacketLogicalOffset;
+
+        if (prefetcher_)
+            prefetcher_->ahead(currentPacketLogicalOffset);
+
+        unique_ptr<PacketLock> packetLock;
+        auto dpkt = dataPacket(currentPacketLogicalOffset, packetLock);
+
+        if (dpkt->header.packetType != DATA_PACKET)
+            throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "packetType=" + toString(dpkt->header.packetType));
+
+        unsigned int bsbLength = 0;
+        const char*  bsbStart = dpkt->getBytestream(channel.bytestreamNumber, bsbLength);
+
+        if (channel.currentBytestreamBufferIndex > bsbLength) {
+            throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
+                                 "currentBytestreamBufferIndex =" + toString(channel.currentBytestreamBufferIndex)
+                                 + " bsbLength=" + toString(bsbLength));
+        }
+
+        channel.currentBytestreamBufferIndex += channel.decoder->inputProcess(&bsbStart[channel.currentBytestreamBufferIndex],
+                                                                              bsbLength - channel.currentBytestreamBufferIndex);
+
+        if (!channel.isInputBlocked())
+            continue;
+
+        /// Move on to next data packet of the section, if any
+        const uint64_t nextPacketLogicalOffset =
+                findNextDataPacket(currentPacketLogicalOffset + dpkt->header.packetLogicalLengthMinus1 + 1);
+
+        if (nextPacketLogicalOffset == E57_UINT64_MAX) {
+            channel.inputFinished = true;
+            break;
+        }
+
+        dpkt = dataPacket(nextPacketLogicalOffset, packetLock);
+
+        channel.currentPacketLogicalOffset    = nextPacketLogicalOffset;
+        channel.currentBytestreamBufferIndex  = 0;
+        channel.currentBytestreamBufferLength = dpkt->getBytestreamBufferLength(channel.bytestreamNumber);
+    }
+}
+
 uint64_t CompressedVectorReaderImpl::findNextDataPacket(uint64_t nextPacketLogicalOffset)
 {
 #ifdef E57_MAX_VERBOSE
@@ -2246,12 +2591,211 @@ uint64_t CompressedVectorReaderImpl::findNextDataPacket(uint64_t nextPacketLogic
     return E57_UINT64_MAX;
 }
 
-void CompressedVectorReaderImpl::seek(uint64_t /*recordNumber*/)
+void CompressedVectorReaderImpl::seek(uint64_t recordNumber)
 {
     checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+    checkReaderOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
 
-    ///!!! implement
-    throw E57_EXCEPTION1(E57_ERROR_NOT_IMPLEMENTED);
+    /// Seeking to one past the last record is allowed, next read() will return 0 records.
+    if (recordNumber > maxRecordCount_) {
+        throw E57_EXCEPTION2(E57_ERROR_BAD_API_ARGUMENT,
+                             "recordNumber=" + toString(recordNumber)
+                             + " maxRecordCount=" + toString(maxRecordCount_)
+                             + " imageFileName=" + cVector_->imageFileName()
+                             + " cvPathName=" + cVector_->pathName());
+    }
+
+    /// Can only calc position in bytestream if every record has same number of bits.
+    /// Strings are variable length, so can only go back to the beginning.
+    vector<unsigned> bitsPerRecord(channels_.size());
+    for (unsigned i = 0; i < channels_.size(); i++) {
+        if (!channels_[i].decoder->fixedBitsPerRecord(bitsPerRecord[i]) && recordNumber != 0) {
+            throw E57_EXCEPTION2(E57_ERROR_NOT_IMPLEMENTED,
+                                 "recordNumber=" + toString(recordNumber)
+                                 + " imageFileName=" + cVector_->imageFileName()
+                                 + " cvPathName=" + cVector_->pathName()
+                                 + " dbufPathName=" + channels_[i].dbuf.pathName());
+        }
+    }
+
+    if (indexLogicalOffset_ != 0) {
+        /// Use index packets to get close, then walk forward through data packets of the chunk.
+        uint64_t chunkRecordNumber = 0;
+        uint64_t chunkLogicalOffset = 0;
+        findChunk(recordNumber, chunkRecordNumber, chunkLogicalOffset);
+
+        for (unsigned i = 0; i < channels_.size(); i++) {
+            uint64_t bitOffset = (recordNumber - chunkRecordNumber) * bitsPerRecord[i];
+            seekChannelFromChunk(channels_[i], bitOffset, chunkLogicalOffset);
+            channels_[i].decoder->seek(recordNumber, static_cast<unsigned>(bitOffset % 8));
+        }
+    } else {
+        /// No index in file, scan data packet headers once and remember where each bytestream buffer starts.
+        if (packetIndexLogicalOffsets_.empty())
+            buildPacketIndex();
+
+        for (unsigned i = 0; i < channels_.size(); i++) {
+            uint64_t bitOffset = recordNumber * bitsPerRecord[i];
+            seekChannelFromPacketIndex(channels_[i], i, bitOffset);
+            channels_[i].decoder->seek(recordNumber, static_cast<unsigned>(bitOffset % 8));
+        }
+    }
+
+    /// Decoders have dropped their queued input, so every channel needs feeding again.
+    for (auto &channel : channels_)
+        channel.inputFinished = false;
+
+    recordCount_ = recordNumber;
+}
+
+void CompressedVectorReaderImpl::findChunk(uint64_t recordNumber, uint64_t& chunkRecordNumber, uint64_t& chunkLogicalOffset)
+{
+    ImageFileImplSharedPtr imf(cVector_->destImageFile_);
+
+    /// Default to beginning of section, in case first index entry doesn't start at record 0.
+    chunkRecordNumber  = 0;
+    chunkLogicalOffset = dataLogicalOffset_;
+
+    /// Walk down the index tree, picking the last entry at each level that starts at or before recordNumber.
+    /// Copy out what we need before going down a level, so only one packet is locked at a time.
+    uint64_t packetLogicalOffset = indexLogicalOffset_;
+    for (unsigned depth = 0; ; depth++) {
+        /// Index tree is at most 5 levels deep, anything more means the file is corrupt (or has a loop).
+        if (depth > 5) {
+            throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
+                                 "indexDepth=" + toString(depth)
+                                 + " packetLogicalOffset=" + toString(packetLogicalOffset));
+        }
+
+        unsigned indexLevel = 0;
+        {
+            char* anyPacket = nullptr;
+            unique_ptr<PacketLock> packetLock = cache_->lock(packetLogicalOffset, anyPacket);
+
+            auto ipkt = reinterpret_cast<const IndexPacket*>(anyPacket);
+            if (ipkt->packetType != INDEX_PACKET)
+                throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "packetType=" + toString(ipkt->packetType));
+
+            /// Binary search for first entry after recordNumber, the one before it is the one we want.
+            const IndexPacket::IndexPacketEntry* first = &ipkt->entries[0];
+            const IndexPacket::IndexPacketEntry* last  = &ipkt->entries[ipkt->entryCount];
+            const IndexPacket::IndexPacketEntry* found =
+                    std::upper_bound(first, last, recordNumber,
+                                     [](uint64_t n, const IndexPacket::IndexPacketEntry& e) { return n < e.chunkRecordNumber; });
+            if (found == first) {
+                if (depth == 0)
+                    return;
+
+                /// A child packet's first entry repeats its parent's entry, which starts at or before recordNumber.
+                throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
+                                     "recordNumber=" + toString(recordNumber)
+                                     + " packetLogicalOffset=" + toString(packetLogicalOffset));
+            }
+            --found;
+
+            chunkRecordNumber   = found->chunkRecordNumber;
+            packetLogicalOffset = imf->file_->physicalToLogical(found->chunkPhysicalOffset);
+            indexLevel          = ipkt->indexLevel;
+        }
+
+        /// Entries of level 0 index packets point at data packets, so we are done.
+        if (indexLevel == 0) {
+            chunkLogicalOffset = packetLogicalOffset;
+            return;
+        }
+    }
+}
+
+void CompressedVectorReaderImpl::seekChannelFromChunk(DecodeChannel& channel, uint64_t bitOffset, uint64_t chunkLogicalOffset)
+{
+    /// Every bytestream starts fresh at a chunk, so count bytes forward from the chunk's first data packet.
+    uint64_t byteOffset = bitOffset / 8;
+    uint64_t packetLogicalOffset = findNextDataPacket(chunkLogicalOffset);
+    if (packetLogicalOffset == E57_UINT64_MAX)
+        throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "chunkLogicalOffset=" + toString(chunkLogicalOffset));
+
+    while (true) {
+        unsigned bsbLength = 0;
+        uint64_t packetEnd = 0;
+        {
+            char* anyPacket = nullptr;
+            unique_ptr<PacketLock> packetLock = cache_->lock(packetLogicalOffset, anyPacket);
+
+            auto dpkt = reinterpret_cast<DataPacket*>(anyPacket);
+            bsbLength = dpkt->getBytestreamBufferLength(channel.bytestreamNumber);
+            packetEnd = packetLogicalOffset + dpkt->header.packetLogicalLengthMinus1 + 1;
+        }
+
+        /// Stop if target byte is in this packet, or there are no more packets (seek to end of records).
+        uint64_t nextPacketLogicalOffset = E57_UINT64_MAX;
+        if (byteOffset >= bsbLength)
+            nextPacketLogicalOffset = findNextDataPacket(packetEnd);
+        if (nextPacketLogicalOffset == E57_UINT64_MAX) {
+            channel.currentPacketLogicalOffset    = packetLogicalOffset;
+            channel.currentBytestreamBufferIndex  = static_cast<size_t>(std::min<uint64_t>(byteOffset, bsbLength));
+            channel.currentBytestreamBufferLength = bsbLength;
+            return;
+        }
+
+        byteOffset -= bsbLength;
+        packetLogicalOffset = nextPacketLogicalOffset;
+    }
+}
+
+void CompressedVectorReaderImpl::buildPacketIndex()
+{
+    ImageFileImplSharedPtr imf(cVector_->destImageFile_);
+
+    packetIndexLogicalOffsets_.clear();
+    packetIndexStreamOffsets_.assign(channels_.size(), vector<uint64_t>(1, 0));
+
+    /// Only need the headers and bytestream length tables, so read them directly rather than pulling whole packets through cache.
+    uint64_t packetLogicalOffset = dataLogicalOffset_;
+    while (packetLogicalOffset < sectionEndLogicalOffset_) {
+        DataPacketHeader header;
+        imf->file_->readAt(packetLogicalOffset, reinterpret_cast<char*>(&header), sizeof(header));
+
+        /// Index and empty packets have their length in the same place as data packets.
+        if (header.packetType == DATA_PACKET) {
+            if (header.bytestreamCount > 0) {
+                vector<uint16_t> bsbLength(header.bytestreamCount);
+                imf->file_->readAt(packetLogicalOffset + sizeof(header), reinterpret_cast<char*>(bsbLength.data()), header.bytestreamCount*sizeof(uint16_t));
+
+                for (unsigned i = 0; i < channels_.size(); i++) {
+                    uint64_t length = (channels_[i].bytestreamNumber < header.bytestreamCount) ? bsbLength[channels_[i].bytestreamNumber] : 0;
+                    packetIndexStreamOffsets_[i].push_back(packetIndexStreamOffsets_[i].back() + length);
+                }
+            } else {
+                for (auto &streamOffsets : packetIndexStreamOffsets_)
+                    streamOffsets.push_back(streamOffsets.back());
+            }
+            packetIndexLogicalOffsets_.push_back(packetLogicalOffset);
+        }
+
+        packetLogicalOffset += header.packetLogicalLengthMinus1 + 1;
+    }
+
+    if (packetIndexLogicalOffsets_.empty())
+        throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "dataLogicalOffset=" + toString(dataLogicalOffset_));
+}
+
+void CompressedVectorReaderImpl::seekChannelFromPacketIndex(DecodeChannel& channel, size_t channelIndex, uint64_t bitOffset)
+{
+    /// Find the last packet whose bytestream buffer starts at or before the target byte.
+    /// Skips over packets that have no data for this bytestream.
+    const vector<uint64_t>& streamOffsets = packetIndexStreamOffsets_.at(channelIndex);
+    uint64_t byteOffset = bitOffset / 8;
+    size_t packetCount = packetIndexLogicalOffsets_.size();
+
+    size_t packetIndex = std::upper_bound(streamOffsets.begin(), streamOffsets.begin() + packetCount, byteOffset) - streamOffsets.begin();
+    if (packetIndex > 0)
+        --packetIndex;
+
+    uint64_t bsbLength = streamOffsets[packetIndex+1] - streamOffsets[packetIndex];
+
+    channel.currentPacketLogicalOffset    = packetIndexLogicalOffsets_[packetIndex];
+    channel.currentBytestreamBufferIndex  = static_cast<size_t>(std::min<uint64_t>(byteOffset - streamOffsets[packetIndex], bsbLength));
+    channel.currentBytestreamBufferLength = static_cast<size_t>(bsbLength);
 }
 
 bool CompressedVectorReaderImpl::isOpen() const
@@ -2271,6 +2815,9 @@ void CompressedVectorReaderImpl::close()
     ImageFileImplSharedPtr imf(cVector_->destImageFile_);
     imf->decrReaderCount();
 
+    if (prefetcher_)
+        imf->removePrefetcher(prefetcher_.get());
+
     checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
 
     /// No error if reader not open
@@ -2280,8 +2827,8 @@ void CompressedVectorReaderImpl::close()
     /// Destroy decoders
     channels_.clear();
 
-    delete cache_;
-    cache_ = nullptr;
+    prefetcher_.reset();
+    cache_.reset();
 
     isOpen_ = false;
 }
@@ -38,6 +38,7 @@ namespace e57
 class E57XmlParser;
 class Decoder;
 class Encoder;
+class WorkerPool;
 
 //================================================================
 
@@ -314,10 +315,16 @@ private:
     void        setBuffers(std::vector<SourceDestBuffer>& dbufs); //???needed?
     uint64_t    earliestPacketNeededForInput() const;
 
-    DataPacket *dataPacket( uint64_t inLogicalOffset ) const;
+    DataPacket *dataPacket( uint64_t inLogicalOffset, std::unique_ptr<PacketLock> &packetLock ) const;
     void        feedPacketToDecoders(uint64_t currentPacketLogicalOffset);
+    void        feedPacketsToChannel(DecodeChannel& channel);
     uint64_t    findNextDataPacket(uint64_t nextPacketLogicalOffset);
 
+    void        findChunk(uint64_t recordNumber, uint64_t& chunkRecordNumber, uint64_t& chunkLogicalOffset);
+    void        buildPacketIndex();
+    void        seekChannelFromChunk(DecodeChannel& channel, uint64_t bitOffset, uint64_t chunkLogicalOffset);
+    void        seekChannelFromPacketIndex(DecodeChannel& channel, size_t channelIndex, uint64_t bitOffset);
+
     //??? no default ctor, copy, assignment?
 
     bool                                      isOpen_;
@@ -325,11 +332,22 @@ private:
     std::shared_ptr<CompressedVectorNodeImpl> cVector_;
     NodeImplSharedPtr                         proto_;
     std::vector<DecodeChannel>                channels_;
-    PacketReadCache*                          cache_;
+    std::shared_ptr<PacketReadCache>          cache_;     /// shared with other readers of the ImageFile
+    std::unique_ptr<PacketPrefetcher>         prefetcher_; /// reads ahead into cache_, if turned on
+    std::shared_ptr<WorkerPool>               decodePool_; /// decodes channels concurrently, if turned on for the ImageFile
+    std::unique_ptr<PointBlockImpl>           interleaveColumns_; /// what the decoders fill, if dbufs are fields of one array of records
 
     uint64_t    recordCount_;                   /// number of records written so far
     uint64_t    maxRecordCount_;
     uint64_t    sectionEndLogicalOffset_;
+    uint64_t    dataLogicalOffset_;             /// first data packet
+    uint64_t    indexLogicalOffset_;            /// top level index packet, 0 if section has no index
+
+    /// Substitute for missing index packets, built on first seek by scanning the data packet headers.
+    /// packetIndexStreamOffsets_[i][j] is the byte position in channel i's bytestream where data packet j starts,
+    /// with one extra entry at the end holding the total bytestream length.
+    std::vector<uint64_t>                     packetIndexLogicalOffsets_;
+    std::vector<std::vector<uint64_t> >       packetIndexStreamOffsets_;
 };
 
 //================================================================
@@ -357,6 +375,8 @@ private:
     size_t      currentPacketSize() const;
     uint64_t    packetWrite();
     void        flush();
+    bool        atChunkBoundary() const;
+    uint64_t    indexPacketsWrite();
 
     //??? no default ctor, copy, assignment?
 
@@ -365,6 +385,8 @@ private:
     NodeImplSharedPtr                         proto_;
 
     std::vector<std::shared_ptr<Encoder> >  bytestreams_;
+    std::shared_ptr<WorkerPool>             encodePool_;    /// encodes bytestreams concurrently, if turned on for the ImageFile
+    std::unique_ptr<PointBlockImpl>         interleaveColumns_; /// what the encoders read, if sbufs are fields of one array of records
     DataPacket              dataPacket_;
 
     bool                    isOpen_;
@@ -375,6 +397,12 @@ private:
     uint64_t                recordCount_;                   /// number of records written so far
     uint64_t                dataPacketsCount_;              /// number of data packets written so far
     uint64_t                indexPacketsCount_;             /// number of index packets written so far
+
+    /// Chunks start at a data packet where every bytestream begins at the same record, these are what index packets point to
+    std::vector<IndexPacket::IndexPacketEntry> chunkIndex_; /// chunk starts written so far, physical offsets of data packets
+    bool                    chunkIndexEnabled_;             /// false if prototype has variable length fields
+    bool                    chunkStartPending_;             /// next data packet written starts a chunk
+    uint64_t                chunkStartRecordNumber_;        /// first record of pending chunk
 };
 
 } /// end namespace e57
@@ -24,64 +24,42 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+
+#ifndef E57_BUILTIN_XML_PARSER
+#include <xercesc/sax/InputSource.hpp>
 #include <xercesc/sax2/Attributes.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
 #include <xercesc/sax2/XMLReaderFactory.hpp>
 
 #include <xercesc/util/BinInputStream.hpp>
 #include <xercesc/util/TransService.hpp>
+#endif
 
 #include "CheckedFile.h"
 #include "E57FormatImpl.h"
 #include "E57XmlParser.h"
 #include "ImageFileImpl.h"
+#include "XmlReader.h"
 
 using namespace e57;
 using namespace std;
+#ifndef E57_BUILTIN_XML_PARSER
 using namespace XERCES_CPP_NAMESPACE;
+#endif
 
 
 // define convenient constants for the attribute names
-static const XMLCh att_minimum[] = {
-    chLatin_m, chLatin_i, chLatin_n, chLatin_i, chLatin_m, chLatin_u,
-    chLatin_m, chNull
-};
-static const XMLCh att_maximum[] = {
-    chLatin_m, chLatin_a, chLatin_x, chLatin_i, chLatin_m, chLatin_u,
-    chLatin_m, chNull
-};
-static const XMLCh att_scale[] = {
-    chLatin_s, chLatin_c, chLatin_a, chLatin_l, chLatin_e, chNull
-};
-static const XMLCh att_offset[] = {
-    chLatin_o, chLatin_f, chLatin_f, chLatin_s, chLatin_e, chLatin_t, chNull
-};
-static const XMLCh att_precision[] = {
-    chLatin_p, chLatin_r, chLatin_e, chLatin_c, chLatin_i, chLatin_s,
-    chLatin_i, chLatin_o, chLatin_n, chNull
-};
-static const XMLCh att_allowHeterogeneousChildren[] = {
-    chLatin_a, chLatin_l, chLatin_l, chLatin_o, chLatin_w, chLatin_H,
-    chLatin_e, chLatin_t, chLatin_e, chLatin_r, chLatin_o, chLatin_g,
-    chLatin_e, chLatin_n, chLatin_e, chLatin_o, chLatin_u, chLatin_s,
-    chLatin_C, chLatin_h, chLatin_i, chLatin_l, chLatin_d, chLatin_r,
-    chLatin_e, chLatin_n, chNull
-};
-static const XMLCh att_fileOffset[] = {
-    chLatin_f, chLatin_i, chLatin_l, chLatin_e, chLatin_O, chLatin_f,
-    chLatin_f, chLatin_s, chLatin_e, chLatin_t, chNull
-};
-
-static const XMLCh att_type[] = {
-    chLatin_t, chLatin_y, chLatin_p, chLatin_e, chNull
-};
-static const XMLCh att_length[] = {
-    chLatin_l, chLatin_e, chLatin_n, chLatin_g, chLatin_t, chLatin_h,
-    chNull
-};
-static const XMLCh att_recordCount[] = {
-    chLatin_r, chLatin_e, chLatin_c, chLatin_o, chLatin_r, chLatin_d,
-    chLatin_C, chLatin_o, chLatin_u, chLatin_n, chLatin_t, chNull
-};
+static const char att_minimum[] = "minimum";
+static const char att_maximum[] = "maximum";
+static const char att_scale[] = "scale";
+static const char att_offset[] = "offset";
+static const char att_precision[] = "precision";
+static const char att_allowHeterogeneousChildren[] = "allowHeterogeneousChildren";
+static const char att_fileOffset[] = "fileOffset";
+
+static const char att_type[] = "type";
+static const char att_length[] = "length";
+static const char att_recordCount[] = "recordCount";
 
 inline int64_t  convertStrToLL( const std::string &inStr )
 {
@@ -94,6 +72,7 @@ inline int64_t  convertStrToLL( const std::string &inStr )
 #endif
 }
 
+#ifndef E57_BUILTIN_XML_PARSER
 //=============================================================================
 // E57FileInputStream
 
@@ -167,6 +146,24 @@ XMLSize_t E57FileInputStream::readBytes(       XMLByte* const  toFill
 //=============================================================================
 // E57XmlFileInputSource
 
+class E57XmlFileInputSource : public InputSource
+{
+public :
+    E57XmlFileInputSource(CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength);
+    ~E57XmlFileInputSource() override = default;
+
+    E57XmlFileInputSource(const E57XmlFileInputSource&) = delete;
+    E57XmlFileInputSource& operator=(const E57XmlFileInputSource&) = delete;
+
+    BinInputStream* makeStream() const override;
+
+private :
+    //??? lifetime of cf_ must be longer than this object!
+    CheckedFile*    cf_;
+    uint64_t        logicalStart_;
+    uint64_t        logicalLength_;
+};
+
 E57XmlFileInputSource::E57XmlFileInputSource(CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength)
 : InputSource("E57File", XMLPlatformUtils::fgMemoryManager),  //??? what if want to use our own memory manager?, what bufid is good?
   cf_(cf),
@@ -180,6 +177,159 @@ BinInputStream* E57XmlFileInputSource::makeStream() const
     return new E57FileInputStream(cf_, logicalStart_, logicalLength_);
 }
 
+
+//=============================================================================
+// E57XmlParser::SaxHandler
+
+class E57XmlParser::SaxHandler : public DefaultHandler
+{
+public :
+    SaxHandler(E57XmlParser& parser);
+    ~SaxHandler() override;
+
+    void init();
+    void parse( InputSource &inputSource );
+
+private :
+    /// SAX interface
+    void startElement(const XMLCh* const uri, const XMLCh* const localName, const XMLCh* const qName, const Attributes& attributes) override;
+    void endElement( const XMLCh* const uri,
+                     const XMLCh* const localName,
+                     const XMLCh* const qName) override;
+    void characters(const XMLCh* const chars, const XMLSize_t length) override;
+
+    /// SAX error interface
+    void warning(const SAXParseException& ex) override;
+    void error(const SAXParseException& ex) override;
+    void fatalError(const SAXParseException& ex) override;
+
+    ustring toUString(const XMLCh* const xml_str);
+
+    E57XmlParser&   parser_;
+    XmlAttributes   attributes_;    /// Transcoded attributes of the current element, reused between elements
+
+    SAX2XMLReader  *xmlReader;
+};
+
+E57XmlParser::SaxHandler::SaxHandler(E57XmlParser& parser)
+: parser_(parser),
+  xmlReader( nullptr )
+{
+}
+
+E57XmlParser::SaxHandler::~SaxHandler()
+{
+   delete xmlReader;
+
+   xmlReader = nullptr;
+
+   XMLPlatformUtils::Terminate();
+}
+
+void E57XmlParser::SaxHandler::init()
+{
+   // Initialize the XML4C2 system
+   try {
+      XMLPlatformUtils::Initialize();
+   } catch (const XMLException& ex) {
+      /// Turn parser exception into E57Exception
+      throw E57_EXCEPTION2(E57_ERROR_XML_PARSER_INIT, "parserMessage=" + ustring(XMLString::transcode(ex.getMessage())));
+   }
+
+   xmlReader = XMLReaderFactory::createXMLReader(); //??? auto_ptr?
+
+   if ( xmlReader == nullptr )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_XML_PARSER_INIT, "could not create the xml reader" );
+   }
+
+   //??? check these are right
+   xmlReader->setFeature(XMLUni::fgSAX2CoreValidation,        true);
+   xmlReader->setFeature(XMLUni::fgXercesDynamic,             true);
+   xmlReader->setFeature(XMLUni::fgSAX2CoreNameSpaces,        true);
+   xmlReader->setFeature(XMLUni::fgXercesSchema,              true);
+   xmlReader->setFeature(XMLUni::fgXercesSchemaFullChecking,  true);
+   xmlReader->setFeature(XMLUni::fgSAX2CoreNameSpacePrefixes, true);
+
+   xmlReader->setContentHandler( this );
+   xmlReader->setErrorHandler( this );
+}
+
+void E57XmlParser::SaxHandler::parse( InputSource &inputSource )
+{
+   xmlReader->parse( inputSource );
+}
+
+void E57XmlParser::SaxHandler::startElement(const   XMLCh* const    uri,
+                                            const   XMLCh* const    localName,
+                                            const   XMLCh* const    qName,
+                                            const   Attributes&     attributes)
+{
+    attributes_.resize(attributes.getLength());
+    for (size_t i = 0; i < attributes.getLength(); i++) {
+        attributes_[i].qName = toUString(attributes.getQName(i));
+        attributes_[i].localName = toUString(attributes.getLocalName(i));
+        attributes_[i].uri = toUString(attributes.getURI(i));
+        attributes_[i].value = toUString(attributes.getValue(i));
+    }
+
+    parser_.startElement(toUString(uri), toUString(localName), toUString(qName), attributes_);
+}
+
+void E57XmlParser::SaxHandler::endElement(const XMLCh* const uri,
+                                          const XMLCh* const localName,
+                                          const XMLCh* const qName)
+{
+    parser_.endElement(toUString(uri), toUString(localName), toUString(qName));
+}
+
+void E57XmlParser::SaxHandler::characters(const   XMLCh* const chars,
+                                          const   XMLSize_t    length)
+{
+    //??? use length to make ustring
+    ustring s = toUString(chars);
+    parser_.characters(s.data(), s.length());
+}
+
+void E57XmlParser::SaxHandler::error(const SAXParseException& ex)
+{
+    throw E57_EXCEPTION2(E57_ERROR_XML_PARSER,
+                         "systemId=" + ustring(XMLString::transcode(ex.getSystemId()))
+                         + " xmlLine=" + toString(ex.getLineNumber())
+                         + " xmlColumn=" + toString(ex.getColumnNumber())
+                         + " parserMessage=" + ustring(XMLString::transcode(ex.getMessage())));
+}
+
+void E57XmlParser::SaxHandler::fatalError(const SAXParseException& ex)
+{
+    throw E57_EXCEPTION2(E57_ERROR_XML_PARSER,
+                         "systemId=" + ustring(XMLString::transcode(ex.getSystemId()))
+                         + " xmlLine=" + toString(ex.getLineNumber())
+                         + " xmlColumn=" + toString(ex.getColumnNumber())
+                         + " parserMessage=" + ustring(XMLString::transcode(ex.getMessage())));
+}
+
+void E57XmlParser::SaxHandler::warning(const SAXParseException& ex)
+{
+    /// Don't take any action on warning from parser, just report
+    cerr << "**** XML parser warning: " << ustring(XMLString::transcode(ex.getMessage())) << endl;
+    cerr << "  Debug info:" << endl;
+    cerr << "    systemId=" << XMLString::transcode(ex.getSystemId()) << endl;
+    cerr << ",   xmlLine="     << ex.getLineNumber() << endl;
+    cerr << ",   xmlColumn="   << ex.getColumnNumber() << endl;
+}
+
+ustring E57XmlParser::SaxHandler::toUString(const XMLCh* const xml_str)
+{
+    ustring u_str;
+    if (xml_str && *xml_str) {
+        TranscodeToStr UTF8Transcoder(xml_str, "UTF-8");
+        u_str  = ustring(reinterpret_cast<const char*>(UTF8Transcoder.str()));
+    }
+    return(u_str);
+}
+#endif
+
 //=============================================================================
 // E57XmlParser::ParseInfo
 
@@ -225,71 +375,68 @@ void E57XmlParser::ParseInfo::dump(int indent, ostream& os) const
 // E57XmlParser
 
 E57XmlParser::E57XmlParser(ImageFileImplSharedPtr imf)
-: imf_(imf),
-  xmlReader( nullptr )
+: imf_(imf)
 {
 }
 
-E57XmlParser::~E57XmlParser()
-{
-   delete xmlReader;
-
-   xmlReader = nullptr;
-
-   XMLPlatformUtils::Terminate();
-}
+E57XmlParser::~E57XmlParser() = default;
 
 void E57XmlParser::init()
 {
-   // Initialize the XML4C2 system
-   try {
-      XMLPlatformUtils::Initialize();
-   } catch (const XMLException& ex) {
-      /// Turn parser exception into E57Exception
-      throw E57_EXCEPTION2(E57_ERROR_XML_PARSER_INIT, "parserMessage=" + ustring(XMLString::transcode(ex.getMessage())));
-   }
-
-   xmlReader = XMLReaderFactory::createXMLReader(); //??? auto_ptr?
-
-   if ( xmlReader == nullptr )
-   {
-      throw E57_EXCEPTION2( E57_ERROR_XML_PARSER_INIT, "could not create the xml reader" );
-   }
+#ifndef E57_BUILTIN_XML_PARSER
+   saxHandler_.reset(new SaxHandler(*this));
+   saxHandler_->init();
+#endif
+}
 
-   //??? check these are right
-   xmlReader->setFeature(XMLUni::fgSAX2CoreValidation,        true);
-   xmlReader->setFeature(XMLUni::fgXercesDynamic,             true);
-   xmlReader->setFeature(XMLUni::fgSAX2CoreNameSpaces,        true);
-   xmlReader->setFeature(XMLUni::fgXercesSchema,              true);
-   xmlReader->setFeature(XMLUni::fgXercesSchemaFullChecking,  true);
-   xmlReader->setFeature(XMLUni::fgSAX2CoreNameSpacePrefixes, true);
+void E57XmlParser::parse( CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength )
+{
+#ifdef E57_BUILTIN_XML_PARSER
+   XmlReader reader(cf, logicalStart, logicalLength);
+   reader.parse( *this );
+#else
+   E57XmlFileInputSource xmlSection(cf, logicalStart, logicalLength);
+   saxHandler_->parse( xmlSection );
+#endif
+}
 
-   xmlReader->setContentHandler( this );
-   xmlReader->setErrorHandler( this );
+void E57XmlParser::parseLazily( CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength, XmlIndex& index )
+{
+   XmlReader reader(cf, logicalStart, logicalLength, index);
+   reader.parse( *this );
 }
 
-void E57XmlParser::parse( InputSource &inputSource )
+void E57XmlParser::parseChildren( CheckedFile* cf, const XmlIndex& index, size_t extent, const NodeImplSharedPtr& container )
 {
-   xmlReader->parse( inputSource );
+   /// Carry on as if the start tag of container had just been read
+   ParseInfo pi;
+   pi.nodeType = container->type();
+   pi.container_ni = container;
+   stack_.push(pi);
+
+   XmlReader reader(cf, index, extent);
+   reader.parse( *this );
+
+   stack_.pop();
 }
 
-void E57XmlParser::startElement(const   XMLCh* const    uri,
-                                const   XMLCh* const    localName,
-                                const   XMLCh* const    qName,
-                                const   Attributes&     attributes)
+void E57XmlParser::startElement(const   ustring&        uri,
+                                const   ustring&        localName,
+                                const   ustring&        qName,
+                                const   XmlAttributes&  attributes)
 {
 #ifdef E57_MAX_VERBOSE
     cout << "startElement" << endl;
-    cout << space(2) << "URI:       " << toUString(uri) << endl;
-    cout << space(2) << "localName: " << toUString(localName) << endl;
-    cout << space(2) << "qName:     " << toUString(qName) << endl;
+    cout << space(2) << "URI:       " << uri << endl;
+    cout << space(2) << "localName: " << localName << endl;
+    cout << space(2) << "qName:     " << qName << endl;
 
-    for (size_t i = 0; i < attributes.getLength(); i++) {
+    for (size_t i = 0; i < attributes.size(); i++) {
         cout << space(2) << "Attribute[" << i << "]" << endl;
-        cout << space(4) << "URI:       " << toUString(attributes.getURI(i)) << endl;
-        cout << space(4) << "localName: " << toUString(attributes.getLocalName(i)) << endl;
-        cout << space(4) << "qName:     " << toUString(attributes.getQName(i)) << endl;
-        cout << space(4) << "value:     " << toUString(attributes.getValue(i)) << endl;
+        cout << space(4) << "URI:       " << attributes[i].uri << endl;
+        cout << space(4) << "localName: " << attributes[i].localName << endl;
+        cout << space(4) << "qName:     " << attributes[i].qName << endl;
+        cout << space(4) << "value:     " << attributes[i].value << endl;
     }
 #endif
     /// Get Type attribute
@@ -385,9 +532,9 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
                 throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                      "precisionString=" + precision_str
                                      + " fileName=" + imf_->fileName()
-                                     + " uri=" + toUString(uri)
-                                     + " localName=" + toUString(localName)
-                                     + " qName=" + toUString(qName));
+                                     + " uri=" + uri
+                                     + " localName=" + localName
+                                     + " qName=" + qName);
             }
         } else {
             /// Not defined defined in XML, so defaults to double
@@ -453,26 +600,26 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
         pi.nodeType = E57_STRUCTURE;
 
         /// Read name space decls, if e57Root element
-        if (toUString(localName) == "e57Root") {
+        if (localName == "e57Root") {
             /// Search attributes for namespace declarations (only allowed in E57Root structure)
             bool gotDefault = false;
-            for (size_t i = 0; i < attributes.getLength(); i++) {
+            for (size_t i = 0; i < attributes.size(); i++) {
                 /// Check if declaring the default namespace
-                if (toUString(attributes.getQName(i)) == "xmlns") {
+                if (attributes[i].qName == "xmlns") {
 #ifdef E57_VERBOSE
-                    cout << "declared default namespace, URI=" << toUString(attributes.getValue(i)) << endl;
+                    cout << "declared default namespace, URI=" << attributes[i].value << endl;
 #endif
-                    imf_->extensionsAdd("", toUString(attributes.getValue(i)));
+                    imf_->extensionsAdd("", attributes[i].value);
                     gotDefault = true;
                 }
 
                 /// Check if declaring a namespace
-                if (toUString(attributes.getURI(i)) == "http://www.w3.org/2000/xmlns/") {
+                if (attributes[i].uri == "http://www.w3.org/2000/xmlns/") {
 #ifdef E57_VERBOSE
-                    cout << "declared extension, prefix=" << toUString(attributes.getLocalName(i))
-                         << " URI=" << toUString(attributes.getValue(i)) << endl;
+                    cout << "declared extension, prefix=" << attributes[i].localName
+                         << " URI=" << attributes[i].value << endl;
 #endif
-                    imf_->extensionsAdd(toUString(attributes.getLocalName(i)), toUString(attributes.getValue(i)));
+                    imf_->extensionsAdd(attributes[i].localName, attributes[i].value);
                 }
             }
 
@@ -480,9 +627,9 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
             if (!gotDefault) {
                 throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                      "fileName=" + imf_->fileName()
-                                     + " uri=" + toUString(uri)
-                                     + " localName=" + toUString(localName)
-                                     + " qName=" + toUString(qName));
+                                     + " uri=" + uri
+                                     + " localName=" + localName
+                                     + " qName=" + qName);
             }
         }
 
@@ -491,7 +638,7 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
         pi.container_ni = s_ni;
 
         /// After have Structure, check again if E57Root, if so mark attached so all children will be attached when added
-        if (toUString(localName) == "e57Root")
+        if (localName == "e57Root")
             s_ni->setAttachedRecursive();
 
         /// Push info so far onto stack
@@ -515,9 +662,9 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
                 throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                      "allowHeterogeneousChildren=" + toString(i64)
                                      + "fileName=" + imf_->fileName()
-                                     + " uri=" + toUString(uri)
-                                     + " localName=" + toUString(localName)
-                                     + " qName=" + toUString(qName));
+                                     + " uri=" + uri
+                                     + " localName=" + localName
+                                     + " qName=" + qName);
             }
         } else {
             /// Not defined defined in XML, so defaults to false
@@ -551,6 +698,7 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
         cv_ni->setRecordCount(pi.recordCount);
         cv_ni->setBinarySectionLogicalStart(imf_->file_->physicalToLogical(pi.fileOffset));  //??? what if file_ is NULL?
         pi.container_ni = cv_ni;
+        compressedVectorDepth_++;
 
         /// Push info so far onto stack
         stack_.push(pi);
@@ -558,18 +706,18 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
         throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                              "nodeType=" + node_type
                              + " fileName=" + imf_->fileName()
-                             + " uri=" + toUString(uri)
-                             + " localName=" + toUString(localName)
-                             + " qName=" + toUString(qName));
+                             + " uri=" + uri
+                             + " localName=" + localName
+                             + " qName=" + qName);
     }
 #ifdef E57_MAX_VERBOSE
     pi.dump(4);
 #endif
 }
 
-void E57XmlParser::endElement(const XMLCh* const uri,
-                              const XMLCh* const localName,
-                              const XMLCh* const qName)
+void E57XmlParser::endElement(const ustring& uri,
+                              const ustring& localName,
+                              const ustring& qName)
 {
 #ifdef E57_MAX_VERBOSE
     cout << "endElement" << endl;
@@ -594,6 +742,7 @@ void E57XmlParser::endElement(const XMLCh* const uri,
         case E57_COMPRESSED_VECTOR: {
             /// Verify that both prototype and codecs child elements were defined ???
             current_ni = pi.container_ni;
+            compressedVectorDepth_--;
             } break;
         case E57_INTEGER: {
             /// Convert child text (if any) to value, else default to 0.0
@@ -637,9 +786,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
             throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
                                  "nodeType=" + toString(pi.nodeType)
                                  + " fileName=" + imf_->fileName()
-                                 + " uri=" + toUString(uri)
-                                 + " localName=" + toUString(localName)
-                                 + " qName=" + toUString(qName));
+                                 + " uri=" + uri
+                                 + " localName=" + localName
+                                 + " qName=" + qName);
     }
 #ifdef E57_MAX_VERBOSE
     current_ni->dump(4);
@@ -652,9 +801,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
             throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                  "currentType=" + toString(current_ni->type())
                                  + " fileName=" + imf_->fileName()
-                                 + " uri=" + toUString(uri)
-                                 + " localName=" + toUString(localName)
-                                 + " qName=" + toUString(qName));
+                                 + " uri=" + uri
+                                 + " localName=" + localName
+                                 + " qName=" + qName);
         }
         imf_->root_ = dynamic_pointer_cast<StructureNodeImpl>(current_ni);
         return;
@@ -666,9 +815,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
     if (!parent_ni) {
         throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                              "fileName=" + imf_->fileName()
-                             + " uri=" + toUString(uri)
-                             + " localName=" + toUString(localName)
-                             + " qName=" + toUString(qName));
+                             + " uri=" + uri
+                             + " localName=" + localName
+                             + " qName=" + qName);
     }
 
     /// Add current node into parent at top of stack
@@ -677,7 +826,7 @@ void E57XmlParser::endElement(const XMLCh* const uri,
             shared_ptr<StructureNodeImpl> struct_ni = dynamic_pointer_cast<StructureNodeImpl>(parent_ni);
 
             /// Add named child to structure
-            struct_ni->set(toUString(qName), current_ni);
+            struct_ni->set(qName, current_ni);
             } break;
         case E57_VECTOR: {
             shared_ptr<VectorNodeImpl> vector_ni = dynamic_pointer_cast<VectorNodeImpl>(parent_ni);
@@ -687,19 +836,17 @@ void E57XmlParser::endElement(const XMLCh* const uri,
             } break;
         case E57_COMPRESSED_VECTOR: {
             shared_ptr<CompressedVectorNodeImpl> cv_ni = dynamic_pointer_cast<CompressedVectorNodeImpl>(parent_ni);
-            ustring uQName = toUString(qName);
-
             /// n can be either prototype or codecs
-            if (uQName == "prototype")
+            if (qName == "prototype")
                 cv_ni->setPrototype(current_ni);
-            else if (uQName == "codecs") {
+            else if (qName == "codecs") {
                 if (current_ni->type() != E57_VECTOR) {
                     throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                          "currentType=" + toString(current_ni->type())
                                          + " fileName=" + imf_->fileName()
-                                         + " uri=" + toUString(uri)
-                                         + " localName=" + toUString(localName)
-                                         + " qName=" + toUString(qName));
+                                         + " uri=" + uri
+                                         + " localName=" + localName
+                                         + " qName=" + qName);
                 }
                 shared_ptr<VectorNodeImpl> vi = dynamic_pointer_cast<VectorNodeImpl>(current_ni);
 
@@ -708,9 +855,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
                     throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                          "currentType=" + toString(current_ni->type())
                                          + " fileName=" + imf_->fileName()
-                                         + " uri=" + toUString(uri)
-                                         + " localName=" + toUString(localName)
-                                         + " qName=" + toUString(qName));
+                                         + " uri=" + uri
+                                         + " localName=" + localName
+                                         + " qName=" + qName);
                 }
 
                 cv_ni->setCodecs(vi);
@@ -718,9 +865,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
                 /// Found unknown XML child element of CompressedVector, not prototype or codecs
                 throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                      + "fileName=" + imf_->fileName()
-                                     + " uri=" + toUString(uri)
-                                     + " localName=" + toUString(localName)
-                                     + " qName=" + toUString(qName));
+                                     + " uri=" + uri
+                                     + " localName=" + localName
+                                     + " qName=" + qName);
             }
         } break;
         default:
@@ -728,18 +875,17 @@ void E57XmlParser::endElement(const XMLCh* const uri,
             throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                  "parentType=" + toString(parent_ni->type())
                                  + " fileName=" + imf_->fileName()
-                                 + " uri=" + toUString(uri)
-                                 + " localName=" + toUString(localName)
-                                 + " qName=" + toUString(qName));
+                                 + " uri=" + uri
+                                 + " localName=" + localName
+                                 + " qName=" + qName);
     }
 }
 
-void E57XmlParser::characters(const   XMLCh* const chars,
-                              const   XMLSize_t    length)
+void E57XmlParser::characters(const   char*   chars,
+                              const   size_t  length)
 {
-//??? use length to make ustring
 #ifdef E57_MAX_VERBOSE
-    cout << "characters, chars=\"" << toUString(chars) << "\" length=" << length << endl;
+    cout << "characters, chars=\"" << ustring(chars, length) << "\" length=" << length << endl;
 #endif
     /// Get active element
     ParseInfo& pi = stack_.top();
@@ -751,64 +897,42 @@ void E57XmlParser::characters(const   XMLCh* const chars,
         case E57_COMPRESSED_VECTOR:
         case E57_BLOB: {
             /// If characters aren't whitespace, have an error, else ignore
-            ustring s = toUString(chars);
+            ustring s(chars, length);
             if (s.find_first_not_of(" \t\n\r") != string::npos)
-                throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT, "chars=" + toUString(chars));
+                throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT, "chars=" + s);
             } break;
         default:
             /// Append to any previous characters
-            pi.childText += toUString(chars);
+            pi.childText.append(chars, length);
     }
 }
 
-void E57XmlParser::error(const SAXParseException& ex)
+bool E57XmlParser::deferChildren(size_t extent)
 {
-    throw E57_EXCEPTION2(E57_ERROR_XML_PARSER,
-                         "systemId=" + ustring(XMLString::transcode(ex.getSystemId()))
-                         + " xmlLine=" + toString(ex.getLineNumber())
-                         + " xmlColumn=" + toString(ex.getColumnNumber())
-                         + " parserMessage=" + ustring(XMLString::transcode(ex.getMessage())));
-}
+    /// Structures and Vectors are left, except in the prototype or codecs of a CompressedVector, which are read whole
+    ParseInfo& pi = stack_.top();
 
-void E57XmlParser::fatalError(const SAXParseException& ex)
-{
-    throw E57_EXCEPTION2(E57_ERROR_XML_PARSER,
-                         "systemId=" + ustring(XMLString::transcode(ex.getSystemId()))
-                         + " xmlLine=" + toString(ex.getLineNumber())
-                         + " xmlColumn=" + toString(ex.getColumnNumber())
-                         + " parserMessage=" + ustring(XMLString::transcode(ex.getMessage())));
-}
+    if ((pi.nodeType != E57_STRUCTURE && pi.nodeType != E57_VECTOR) || compressedVectorDepth_ > 0)
+        return(false);
 
-void E57XmlParser::warning(const SAXParseException& ex)
-{
-    /// Don't take any action on warning from parser, just report
-    cerr << "**** XML parser warning: " << ustring(XMLString::transcode(ex.getMessage())) << endl;
-    cerr << "  Debug info:" << endl;
-    cerr << "    systemId=" << XMLString::transcode(ex.getSystemId()) << endl;
-    cerr << ",   xmlLine="     << ex.getLineNumber() << endl;
-    cerr << ",   xmlColumn="   << ex.getColumnNumber() << endl;
+    static_pointer_cast<StructureNodeImpl>(pi.container_ni)->setUnparsedChildren(extent);
+    return(true);
 }
 
-ustring E57XmlParser::toUString(const XMLCh* const xml_str)
+ustring E57XmlParser::lookupAttribute(const XmlAttributes& attributes, const char* attribute_name)
 {
-    ustring u_str;
-    if (xml_str && *xml_str) {
-        TranscodeToStr UTF8Transcoder(xml_str, "UTF-8");
-        u_str  = ustring(reinterpret_cast<const char*>(UTF8Transcoder.str()));
+    for (const XmlAttribute& attribute : attributes) {
+        if (attribute.qName == attribute_name)
+            return(attribute.value);
     }
-    return(u_str);
-}
-
-ustring E57XmlParser::lookupAttribute(const Attributes& attributes, const XMLCh* attribute_name)
-{
-    XMLSize_t attr_index;
-    if (!attributes.getIndex(attribute_name, attr_index))
-        throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT, "attributeName=" + toUString(attribute_name));
-    return(toUString(attributes.getValue(attr_index)));
+    throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT, "attributeName=" + ustring(attribute_name));
 }
 
-bool E57XmlParser::isAttributeDefined(const Attributes& attributes, const XMLCh* attribute_name)
+bool E57XmlParser::isAttributeDefined(const XmlAttributes& attributes, const char* attribute_name)
 {
-    XMLSize_t attr_index;
-    return(attributes.getIndex(attribute_name, attr_index));
+    for (const XmlAttribute& attribute : attributes) {
+        if (attribute.qName == attribute_name)
+            return(true);
+    }
+    return(false);
 }
@@ -27,48 +27,61 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <memory>
 #include <stack>
-
-#include <xercesc/sax2/DefaultHandler.hpp>
-#include <xercesc/sax/InputSource.hpp>
+#include <vector>
 
 #include "Common.h"
 
-using namespace XERCES_CPP_NAMESPACE;
-
-namespace XERCES_CPP_NAMESPACE {
-   class SAX2XMLReader;
-}
-
 namespace e57 {
    class CheckedFile;
+   struct XmlIndex;
+
+   /// Attribute of an XML element, all strings in UTF-8
+   struct XmlAttribute
+   {
+      ustring     qName;
+      ustring     localName;
+      ustring     uri;        // namespace of the attribute, empty if it has no prefix
+      ustring     value;
+   };
+
+   using XmlAttributes = std::vector<XmlAttribute>;
 
-   class E57XmlParser : public DefaultHandler
+   /// Builds the node tree of an ImageFile from the XML section of its file.
+   /// The XML is read by Xerces-C, or by XmlReader if built with E57_BUILTIN_XML_PARSER.
+   class E57XmlParser
    {
       public:
          E57XmlParser(ImageFileImplSharedPtr imf);
-         ~E57XmlParser() override;
+         ~E57XmlParser();
 
          void init();
 
-         void  parse( InputSource &inputSource );
+         /// Parse logicalLength bytes of XML starting at logicalStart in cf
+         void  parse( CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength );
+
+         /// Parse like parse(), but leave the children of the root to parseChildren(), noting where they are in index.
+         /// Always reads with XmlReader, init() is not needed.
+         void  parseLazily( CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength, XmlIndex& index );
+
+         /// Parse the children of container, left at extent of index by parseLazily() or an earlier parseChildren()
+         void  parseChildren( CheckedFile* cf, const XmlIndex& index, size_t extent, const NodeImplSharedPtr& container );
+
+         /// SAX interface, called by the XML reader with names and text in UTF-8
+         void startElement(const ustring& uri, const ustring& localName, const ustring& qName, const XmlAttributes& attributes);
+         void endElement( const ustring& uri,
+                          const ustring& localName,
+                          const ustring& qName);
+         void characters(const char* chars, size_t length);
+
+         /// Called by XmlReader after startElement() of an element with content, when parsing lazily.
+         /// Returns true if the children of the element are left to be parsed later, from extent.
+         bool deferChildren(size_t extent);
 
       private:
-         /// SAX interface
-         void startElement(const XMLCh* const uri, const XMLCh* const localName, const XMLCh* const qName, const Attributes& attributes) override;
-         void endElement( const XMLCh* const uri,
-                          const XMLCh* const localName,
-                          const XMLCh* const qName) override;
-         void characters(const XMLCh* const chars, const XMLSize_t length) override;
-
-         /// SAX error interface
-         void warning(const SAXParseException& ex) override;
-         void error(const SAXParseException& ex) override;
-         void fatalError(const SAXParseException& ex) override;
-
-         ustring toUString(const XMLCh* const xml_str);
-         ustring lookupAttribute(const Attributes& attributes, const XMLCh* attribute_name);
-         bool    isAttributeDefined(const Attributes& attributes, const XMLCh* attribute_name);
+         ustring lookupAttribute(const XmlAttributes& attributes, const char* attribute_name);
+         bool    isAttributeDefined(const XmlAttributes& attributes, const char* attribute_name);
 
          ImageFileImplSharedPtr imf_;   /// Image file we are reading
 
@@ -97,28 +110,13 @@ namespace e57 {
                void    dump(int indent = 0, std::ostream& os = std::cout) const;
          };
          std::stack<ParseInfo>    stack_; /// Stores the current path in tree we are reading
+         int                      compressedVectorDepth_ = 0;   /// CompressedVector elements on stack_
 
-         SAX2XMLReader  *xmlReader;
-   };
-
-   class E57XmlFileInputSource : public InputSource
-   {
-      public :
-         E57XmlFileInputSource(CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength);
-         ~E57XmlFileInputSource() override = default;
-
-         E57XmlFileInputSource(const E57XmlFileInputSource&) = delete;
-         E57XmlFileInputSource& operator=(const E57XmlFileInputSource&) = delete;
-
-         BinInputStream* makeStream() const override;
-
-      private :
-         //??? lifetime of cf_ must be longer than this object!
-         CheckedFile*    cf_;
-         uint64_t        logicalStart_;
-         uint64_t        logicalLength_;
+#ifndef E57_BUILTIN_XML_PARSER
+         class SaxHandler;      /// Passes Xerces SAX2 events on, see E57XmlParser.cpp
+         std::unique_ptr<SaxHandler> saxHandler_;
+#endif
    };
-
 }
 
 #endif
@@ -27,6 +27,7 @@
 #include <algorithm>
 #include <cstring>
 
+#include "BitUnpack.h"
 #include "Encoder.h"
 #include "E57FormatImpl.h"
 #include "ImageFileImpl.h"
@@ -35,6 +36,12 @@
 using namespace e57;
 using namespace std;
 
+namespace
+{
+   /// Records fetched from the source buffer, range checked and handed to packBits() at a time, sized to stay in L1 cache
+   constexpr size_t packBlockSize = 256;
+}
+
 
 shared_ptr<Encoder> Encoder::EncoderFactory(unsigned bytestreamNumber,
                                             shared_ptr<CompressedVectorNodeImpl> cVector,
@@ -391,23 +398,21 @@ uint64_t BitpackFloatEncoder::processRecords(size_t recordCount)
       auto outp = reinterpret_cast<float*>(&outBuffer_[outBufferEnd_]);
 
       /// Copy floats from sourceBuffer_ to outBuffer_
-      for (unsigned i=0; i < recordCount; i++) {
-         outp[i] = sourceBuffer_->getNextFloat();
+      sourceBuffer_->getNextFloat(outp, recordCount);
 #ifdef E57_MAX_VERBOSE
+      for (unsigned i=0; i < recordCount; i++)
          cout << "encoding float: " << outp[i] << endl;
 #endif
-      }
    } else {  /// E57_DOUBLE precision
       /// Form the starting address for next available location in outBuffer
       auto outp = reinterpret_cast<double*>(&outBuffer_[outBufferEnd_]);
 
       /// Copy doubles from sourceBuffer_ to outBuffer_
-      for (unsigned i=0; i < recordCount; i++) {
-         outp[i] = sourceBuffer_->getNextDouble();
+      sourceBuffer_->getNextDouble(outp, recordCount);
 #ifdef E57_MAX_VERBOSE
+      for (unsigned i=0; i < recordCount; i++)
          cout << "encoding double: " << outp[i] << endl;
 #endif
-      }
    }
 
    /// Update end of outBuffer
@@ -634,15 +639,83 @@ uint64_t BitpackIntegerEncoder<RegisterT>::processRecords(size_t recordCount)
    auto outp = reinterpret_cast<RegisterT*>(&outBuffer_[outBufferEnd_]);
    unsigned outTransferred = 0;
 
-   /// Copy bits from sourceBuffer_ to outBuffer_
+   /// Values up to 32 bits are fetched, range checked and packed a block at a time by the vector kernels
+   if (sizeof(RegisterT) <= sizeof(uint32_t)) {
+      const unsigned registerBits = 8*sizeof(RegisterT);
+      int64_t values[packBlockSize];
+      uint32_t lanes[packBlockSize];
+
+      /// Block's bitstream, starting with the bits left in register_.  Fewer than one word of those, so one extra word will do.
+      RegisterT words[packBlockSize*32/(8*sizeof(RegisterT)) + 1];
+
+      for (size_t done = 0; done < recordCount; ) {
+         const size_t blockCount = min(recordCount - done, packBlockSize);
+
+         /// The parameter isScaledInteger_ determines which version of getNextInt64 gets called
+         if (isScaledInteger_)
+            sourceBuffer_->getNextInt64(values, blockCount, scale_, offset_);
+         else
+            sourceBuffer_->getNextInt64(values, blockCount);
+
+         /// Enforce min/max specification on the whole block at once, only look for the culprit if it fails
+         if (!subtractMinimum(values, blockCount, minimum_, maximum_, lanes)) {
+            for (size_t i = 0; i < blockCount; i++) {
+               if (values[i] < minimum_ || maximum_ < values[i]) {
+                  throw E57_EXCEPTION2(E57_ERROR_VALUE_OUT_OF_BOUNDS,
+                                       "rawValue=" + toString(values[i])
+                                       + " minimum=" + toString(minimum_)
+                                       + " maximum=" + toString(maximum_));
+               }
+            }
+         }
+
+         words[0] = register_;
+         packBits(lanes, bitsPerRecord_, blockCount, reinterpret_cast<char*>(words), registerBitsUsed_);
+
+         /// Transfer the full words, keep the rest in register_ for next time
+         const size_t bitCount = registerBitsUsed_ + blockCount*bitsPerRecord_;
+         const size_t fullWords = bitCount / registerBits;
+#ifdef E57_DEBUG
+         /// Before transfer, double check address within bounds
+         if (outTransferred + fullWords > transferMax) {
+            throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
+                                 "outTransferred=" + toString(outTransferred + fullWords)
+                                 + " transferMax" + toString(transferMax));
+         }
+#endif
+         memcpy(&outp[outTransferred], words, fullWords*sizeof(RegisterT));
+         outTransferred += static_cast<unsigned>(fullWords);
+
+         registerBitsUsed_ = static_cast<unsigned>(bitCount % registerBits);
+         register_ = (registerBitsUsed_ > 0) ? static_cast<RegisterT>(words[fullWords] & ((1ULL << registerBitsUsed_) - 1)) : 0;
+
+         done += blockCount;
+#ifdef E57_MAX_VERBOSE
+         cout << "  After " << outTransferred << " transfers and " << done << " records, encoder:" << endl;
+         dump(4);
+#endif
+      }
+
+      outBufferEnd_ += outTransferred * sizeof(RegisterT);
+      currentRecordIndex_ += recordCount;
+      return(currentRecordIndex_);
+   }
+
+   /// Copy bits from sourceBuffer_ to outBuffer_, fetching values a block at a time
+   int64_t values[packBlockSize];
+
    for (unsigned i=0; i < recordCount; i++) {
-      int64_t rawValue;
+      if (i % packBlockSize == 0) {
+         const size_t blockCount = min(recordCount - i, packBlockSize);
+
+         /// The parameter isScaledInteger_ determines which version of getNextInt64 gets called
+         if (isScaledInteger_)
+            sourceBuffer_->getNextInt64(values, blockCount, scale_, offset_);
+         else
+            sourceBuffer_->getNextInt64(values, blockCount);
+      }
 
-      /// The parameter isScaledInteger_ determines which version of getNextInt64 gets called
-      if (isScaledInteger_)
-         rawValue = sourceBuffer_->getNextInt64(scale_, offset_);
-      else
-         rawValue = sourceBuffer_->getNextInt64();
+      int64_t rawValue = values[i % packBlockSize];
 
       /// Enforce min/max specification on value
       if (rawValue < minimum_ || maximum_ < rawValue) {
@@ -798,11 +871,19 @@ uint64_t ConstantIntegerEncoder::processRecords(size_t recordCount)
    dump(4);
 #endif
 
-   /// Check that all source values are == minimum_
-   for (unsigned i = 0; i < recordCount; i++) {
-      int64_t nextInt64 = sourceBuffer_->getNextInt64();
-      if (nextInt64 != minimum_)
-         throw E57_EXCEPTION2(E57_ERROR_VALUE_OUT_OF_BOUNDS, "nextInt64=" + toString(nextInt64) + " minimum=" + toString(minimum_));
+   /// Check that all source values are == minimum_, a block at a time
+   int64_t values[packBlockSize];
+
+   for (size_t done = 0; done < recordCount; ) {
+      const size_t blockCount = min(recordCount - done, packBlockSize);
+      sourceBuffer_->getNextInt64(values, blockCount);
+
+      for (size_t i = 0; i < blockCount; i++) {
+         if (values[i] != minimum_)
+            throw E57_EXCEPTION2(E57_ERROR_VALUE_OUT_OF_BOUNDS, "nextInt64=" + toString(values[i]) + " minimum=" + toString(minimum_));
+      }
+
+      done += blockCount;
    }
 
    /// Update counts of records processed
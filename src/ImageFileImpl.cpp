@@ -24,11 +24,17 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <cstring>
+
 #include "CheckedFile.h"
 #include "E57FormatImpl.h"
 #include "E57Version.h"
 #include "E57XmlParser.h"
 #include "ImageFileImpl.h"
+#include "Packet.h"
+#include "WorkerPool.h"
+#include "XmlReader.h"
 
 namespace e57
 {
@@ -78,6 +84,10 @@ namespace e57
       : isWriter_( false ),
         writerCount_(0),
         readerCount_(0),
+        packetCacheSize_(PACKET_CACHE_DEFAULT_COUNT),
+        packetPrefetchCount_(PACKET_PREFETCH_DEFAULT_COUNT),
+        codecThreadCount_(1),
+        indexPacketsEnabled_(true),
         checksumPolicy( std::max( 0, std::min( policy, 100 ) ) ),
         file_(nullptr),
         xmlLogicalOffset_( 0 ),
@@ -101,10 +111,11 @@ namespace e57
       /// Get shared_ptr to this object
       ImageFileImplSharedPtr imf = shared_from_this();
 
-      // Accept "w" or "r" modes
+      // Accept "w", "r" or "rl" (read lazily) modes
       isWriter_ = (mode == "w");
+      const bool isLazy = (mode == "rl");
 
-      if ( !isWriter_ && (mode != "r") )
+      if ( !isWriter_ && !isLazy && (mode != "r") )
       {
          throw E57_EXCEPTION2(E57_ERROR_BAD_API_ARGUMENT, "mode=" + ustring(mode));
       }
@@ -164,21 +175,29 @@ namespace e57
 
       try
       {
-         /// Create parser state, attach its event handers to the SAX2 reader
+         /// Create parser state, attach its event handers to the XML reader
          E57XmlParser parser(imf);
 
-         parser.init();
-
-         /// Create input source (XML section of E57 file turned into a stream).
-         E57XmlFileInputSource xmlSection(file_, xmlLogicalOffset_, xmlLogicalLength_);
-
          unusedLogicalStart_ = sizeof(E57FileHeader);
 
-         /// Do the parse, building up the node tree
-         parser.parse( xmlSection );
+         if ( isLazy )
+         {
+            /// Only skim the XML section, noting where the children of the root are so they can be parsed when used
+            xmlIndex_.reset( new XmlIndex );
+            parser.parseLazily( file_, xmlLogicalOffset_, xmlLogicalLength_, *xmlIndex_ );
+         }
+         else
+         {
+            parser.init();
+
+            /// Do the parse of the XML section of the file, building up the node tree
+            parser.parse( file_, xmlLogicalOffset_, xmlLogicalLength_ );
+         }
       }
       catch (...)
       {
+         xmlIndex_.reset();
+
          delete file_;
          file_ = nullptr;
 
@@ -227,18 +246,15 @@ namespace e57
 
       try
       {
-         /// Create parser state, attach its event handers to the SAX2 reader
+         /// Create parser state, attach its event handers to the XML reader
          E57XmlParser parser(imf);
 
          parser.init();
 
-         /// Create input source (XML section of E57 file turned into a stream).
-         E57XmlFileInputSource xmlSection(file_, xmlLogicalOffset_, xmlLogicalLength_);
-
          unusedLogicalStart_ = sizeof(E57FileHeader);
 
-         /// Do the parse, building up the node tree
-         parser.parse( xmlSection );
+         /// Do the parse of the XML section of the file, building up the node tree
+         parser.parse( file_, xmlLogicalOffset_, xmlLogicalLength_ );
       }
       catch (...)
       {
@@ -273,6 +289,26 @@ namespace e57
       readerCount_++;
    }
 
+   void ImageFileImpl::addPrefetcher(PacketPrefetcher* prefetcher)
+   {
+      prefetchers_.push_back(prefetcher);
+   }
+
+   void ImageFileImpl::removePrefetcher(PacketPrefetcher* prefetcher)
+   {
+      prefetchers_.erase(std::remove(prefetchers_.begin(), prefetchers_.end(), prefetcher), prefetchers_.end());
+   }
+
+   void ImageFileImpl::stopPrefetchers()
+   {
+      /// Readers left open keep their prefetchers, but those no longer touch file_
+      for (PacketPrefetcher* prefetcher : prefetchers_)
+      {
+         prefetcher->stop();
+      }
+      prefetchers_.clear();
+   }
+
    void ImageFileImpl::decrReaderCount()
    {
       readerCount_--;
@@ -294,6 +330,16 @@ namespace e57
       return root_;
    }
 
+   void ImageFileImpl::parseChildren(const std::shared_ptr<StructureNodeImpl>& container, size_t extent)
+   {
+      /// Parse the children of container, left at extent of xmlIndex_ by a lazy open
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      E57XmlParser parser(shared_from_this());
+
+      parser.parseChildren( file_, *xmlIndex_, extent, container );
+   }
+
    void ImageFileImpl::close()
    {
       /// If file already closed, have nothing to do
@@ -302,6 +348,8 @@ namespace e57
          return;
       }
 
+      stopPrefetchers();
+
       if ( isWriter_ )
       {
          /// Go to end of file, note physical position
@@ -347,6 +395,9 @@ namespace e57
          file_->close();
       }
 
+      packetCache_.reset();
+      xmlIndex_.reset();
+
       delete file_;
       file_ = nullptr;
    }
@@ -359,6 +410,8 @@ namespace e57
          return;
       }
 
+      stopPrefetchers();
+
       /// Close the file and ulink (delete) it.
       /// It is legal to cancel a read file, but file isn't deleted.
       if (isWriter_)
@@ -370,6 +423,9 @@ namespace e57
          file_->close();
       }
 
+      packetCache_.reset();
+      xmlIndex_.reset();
+
       delete file_;
       file_ = nullptr;
    }
@@ -394,6 +450,102 @@ namespace e57
       return readerCount_;
    }
 
+   void ImageFileImpl::setPacketCacheSize(unsigned packetCount)
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      if (packetCount == 0)
+      {
+         throw E57_EXCEPTION2(E57_ERROR_BAD_API_ARGUMENT, "fileName=" + fileName_ + " packetCount=" + toString(packetCount));
+      }
+
+      packetCacheSize_ = packetCount;
+
+      /// Readers created from now on get a cache of the new size.  Open readers keep the old one until they close.
+      packetCache_.reset();
+   }
+
+   unsigned ImageFileImpl::packetCacheSize() const
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      return packetCacheSize_;
+   }
+
+   void ImageFileImpl::setPacketPrefetchCount(unsigned packetCount)
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      packetPrefetchCount_ = packetCount;
+   }
+
+   unsigned ImageFileImpl::packetPrefetchCount() const
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      return packetPrefetchCount_;
+   }
+
+   std::shared_ptr<PacketReadCache> ImageFileImpl::packetCache()
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      if (!packetCache_)
+      {
+         packetCache_ = std::make_shared<PacketReadCache>(file_, packetCacheSize_);
+      }
+
+      return packetCache_;
+   }
+
+   void ImageFileImpl::setCodecThreadCount(unsigned threadCount)
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      if (threadCount == 0)
+      {
+         throw E57_EXCEPTION2(E57_ERROR_BAD_API_ARGUMENT, "fileName=" + fileName_ + " threadCount=" + toString(threadCount));
+      }
+
+      codecThreadCount_ = threadCount;
+
+      /// Writers and readers created from now on get the new threads.  Open ones keep the old threads until they close.
+      codecPool_.reset();
+   }
+
+   unsigned ImageFileImpl::codecThreadCount() const
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      return codecThreadCount_;
+   }
+
+   std::shared_ptr<WorkerPool> ImageFileImpl::codecPool()
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      if (!codecPool_ && codecThreadCount_ > 1)
+      {
+         codecPool_ = std::make_shared<WorkerPool>(codecThreadCount_);
+      }
+
+      return codecPool_;
+   }
+
+   void ImageFileImpl::setIndexPacketsEnabled(bool enable)
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      indexPacketsEnabled_ = enable;
+   }
+
+   bool ImageFileImpl::indexPacketsEnabled() const
+   {
+      checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+
+      return indexPacketsEnabled_;
+   }
+
    ImageFileImpl::~ImageFileImpl()
    {
       /// Try to cancel if not already closed, but don't allow any exceptions to propogate to caller (because in dtor).
@@ -870,6 +1022,10 @@ namespace e57
       os << space(indent) << "fileName:    " << fileName_ << std::endl;
       os << space(indent) << "writerCount: " << writerCount_ << std::endl;
       os << space(indent) << "readerCount: " << readerCount_ << std::endl;
+      os << space(indent) << "packetCacheSize: " << packetCacheSize_ << std::endl;
+      os << space(indent) << "packetPrefetchCount: " << packetPrefetchCount_ << std::endl;
+      os << space(indent) << "codecThreadCount: " << codecThreadCount_ << std::endl;
+      os << space(indent) << "indexPacketsEnabled: " << indexPacketsEnabled_ << std::endl;
       os << space(indent) << "isWriter:    " << isWriter_ << std::endl;
       for (size_t i=0; i < extensionsCount(); i++)
          os << space(indent) << "nameSpace[" << i << "]: prefix=" << extensionsPrefix(i) << " uri=" << extensionsUri(i) << std::endl;
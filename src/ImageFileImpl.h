@@ -34,9 +34,13 @@
 namespace e57
 {
    class CheckedFile;
+   class PacketPrefetcher;
+   class PacketReadCache;
+   class WorkerPool;
 
    struct E57FileHeader;
    struct NameSpace;
+   struct XmlIndex;
 
    class ImageFileImpl : public std::enable_shared_from_this<ImageFileImpl>
    {
@@ -51,6 +55,17 @@ namespace e57
          bool            isWriter() const;
          int             writerCount() const;
          int             readerCount() const;
+         void            setPacketCacheSize(unsigned packetCount);
+         unsigned        packetCacheSize() const;
+         void            setPacketPrefetchCount(unsigned packetCount);
+         unsigned        packetPrefetchCount() const;
+         std::shared_ptr<PacketReadCache> packetCache();
+         void            setCodecThreadCount(unsigned threadCount);
+         unsigned        codecThreadCount() const;
+         std::shared_ptr<WorkerPool> codecPool();
+         void            setIndexPacketsEnabled(bool enable);
+         bool            indexPacketsEnabled() const;
+         void            parseChildren(const std::shared_ptr<StructureNodeImpl>& container, size_t extent);
          ~ImageFileImpl();
 
          uint64_t        allocateSpace(uint64_t byteCount, bool doExtendNow);
@@ -81,6 +96,8 @@ namespace e57
          void            decrWriterCount();
          void            incrReaderCount();
          void            decrReaderCount();
+         void            addPrefetcher(PacketPrefetcher* prefetcher);
+         void            removePrefetcher(PacketPrefetcher* prefetcher);
 
          /// Diagnostic functions:
 #ifdef E57_DEBUG
@@ -96,12 +113,29 @@ namespace e57
          static void     readFileHeader(CheckedFile* file, E57FileHeader& header);
 
          void checkImageFileOpen(const char* srcFileName, int srcLineNumber, const char* srcFunctionName) const;
+         void            stopPrefetchers();
 
          ustring         fileName_;
          bool            isWriter_;
          int             writerCount_;
          int             readerCount_;
 
+         unsigned        packetCacheSize_;   // packets the readers may cache
+         unsigned        packetPrefetchCount_;  // data packets each new reader reads ahead, 0 for none
+
+         /// Shared by all readers, created by the first one
+         std::shared_ptr<PacketReadCache> packetCache_;
+
+         /// Background threads of the open readers, which read through file_.  Stopped before file_ goes away.
+         std::vector<PacketPrefetcher*> prefetchers_;
+
+         unsigned        codecThreadCount_;  // threads writers and readers code bytestreams on, 1 for only the calling thread
+
+         /// Shared by all writers and readers, created by the first one if codecThreadCount_ > 1
+         std::shared_ptr<WorkerPool> codecPool_;
+
+         bool            indexPacketsEnabled_;  // new writers write index packets, if their prototype allows
+
          ReadChecksumPolicy   checksumPolicy;
 
          CheckedFile*    file_;
@@ -110,6 +144,9 @@ namespace e57
          uint64_t        xmlLogicalOffset_;
          uint64_t        xmlLogicalLength_;
 
+         /// Parts of the XML section not parsed yet, if opened with "rl"
+         std::unique_ptr<XmlIndex> xmlIndex_;
+
          /// Write file attributes
          uint64_t        unusedLogicalStart_;
 
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "Interleave.h"
+
+using namespace e57;
+using namespace std;
+
+namespace
+{
+   /// Records handled per pass over the fields, about this many bytes of them
+   constexpr size_t tileBytes = 8*1024;
+
+   /// Pointers are moved on by their stride instead of multiplying an index, the copies have a fixed size.
+   /// Four values per iteration, the loop overhead would otherwise cost more than copies this small.
+   template<typename T>
+   void scatterField(char* record, size_t stride, const char* column, size_t count)
+   {
+      const size_t stride2 = 2*stride;
+      const size_t stride3 = 3*stride;
+      const size_t stride4 = 4*stride;
+
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4, record += stride4, column += 4*sizeof(T))
+      {
+         memcpy(record, column, sizeof(T));
+         memcpy(record + stride, column + sizeof(T), sizeof(T));
+         memcpy(record + stride2, column + 2*sizeof(T), sizeof(T));
+         memcpy(record + stride3, column + 3*sizeof(T), sizeof(T));
+      }
+
+      for (; i < count; i++, record += stride, column += sizeof(T))
+      {
+         memcpy(record, column, sizeof(T));
+      }
+   }
+
+   template<typename T>
+   void gatherField(const char* record, size_t stride, char* column, size_t count)
+   {
+      const size_t stride2 = 2*stride;
+      const size_t stride3 = 3*stride;
+      const size_t stride4 = 4*stride;
+
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4, record += stride4, column += 4*sizeof(T))
+      {
+         memcpy(column, record, sizeof(T));
+         memcpy(column + sizeof(T), record + stride, sizeof(T));
+         memcpy(column + 2*sizeof(T), record + stride2, sizeof(T));
+         memcpy(column + 3*sizeof(T), record + stride3, sizeof(T));
+      }
+
+      for (; i < count; i++, record += stride, column += sizeof(T))
+      {
+         memcpy(column, record, sizeof(T));
+      }
+   }
+
+   void scatterField(const InterleavedField& field, size_t first, size_t stride, size_t count)
+   {
+      char* record = field.record + first*stride;
+      const char* column = field.column + first*field.size;
+
+      switch (field.size)
+      {
+         case 1: scatterField<uint8_t>(record, stride, column, count); break;
+         case 2: scatterField<uint16_t>(record, stride, column, count); break;
+         case 4: scatterField<uint32_t>(record, stride, column, count); break;
+         case 8: scatterField<uint64_t>(record, stride, column, count); break;
+         default:
+            for (size_t i = 0; i < count; i++, record += stride, column += field.size)
+            {
+               memcpy(record, column, field.size);
+            }
+            break;
+      }
+   }
+
+   void gatherField(const InterleavedField& field, size_t first, size_t stride, size_t count)
+   {
+      const char* record = field.record + first*stride;
+      char* column = field.column + first*field.size;
+
+      switch (field.size)
+      {
+         case 1: gatherField<uint8_t>(record, stride, column, count); break;
+         case 2: gatherField<uint16_t>(record, stride, column, count); break;
+         case 4: gatherField<uint32_t>(record, stride, column, count); break;
+         case 8: gatherField<uint64_t>(record, stride, column, count); break;
+         default:
+            for (size_t i = 0; i < count; i++, record += stride, column += field.size)
+            {
+               memcpy(column, record, field.size);
+            }
+            break;
+      }
+   }
+}
+
+void e57::scatterRecords(const vector<InterleavedField>& fields, size_t stride, size_t count)
+{
+   const size_t tileRecords = max<size_t>(1, tileBytes / max<size_t>(1, stride));
+
+   for (size_t first = 0; first < count; first += tileRecords)
+   {
+      const size_t tileCount = min(tileRecords, count - first);
+
+      for (const auto& field : fields)
+      {
+         scatterField(field, first, stride, tileCount);
+      }
+   }
+}
+
+void e57::gatherRecords(const vector<InterleavedField>& fields, size_t stride, size_t count)
+{
+   const size_t tileRecords = max<size_t>(1, tileBytes / max<size_t>(1, stride));
+
+   for (size_t first = 0; first < count; first += tileRecords)
+   {
+      const size_t tileCount = min(tileRecords, count - first);
+
+      for (const auto& field : fields)
+      {
+         gatherField(field, first, stride, tileCount);
+      }
+   }
+}
@@ -0,0 +1,51 @@
+#ifndef INTERLEAVE_H
+#define INTERLEAVE_H
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstddef>
+#include <vector>
+
+namespace e57
+{
+   /// One field of an array of records, and a contiguous column holding the same values back to back
+   struct InterleavedField
+   {
+      char*    record = nullptr;   /// The field in the first record
+      char*    column = nullptr;   /// First value of the column
+      size_t   size = 0;           /// Bytes per value, 1, 2, 4 or 8
+   };
+
+   /// Copy the first count values of each column into the fields of count records, stride bytes apart.
+   /// Works through the records a few kilobytes at a time, filling every field of those before moving on, so each
+   /// cache line of the records is brought in once however many fields share it.
+   void scatterRecords(const std::vector<InterleavedField>& fields, size_t stride, size_t count);
+
+   /// Inverse of scatterRecords(): copy the fields of count records into the first count values of each column
+   void gatherRecords(const std::vector<InterleavedField>& fields, size_t stride, size_t count);
+}
+
+#endif
@@ -32,31 +32,6 @@
 
 using namespace e57;
 
-struct IndexPacket
-{
-      static constexpr unsigned MAX_ENTRIES = 2048;
-
-      const uint8_t     packetType = INDEX_PACKET;
-
-      uint8_t     packetFlags = 0;    // flag bitfields
-      uint16_t    packetLogicalLengthMinus1 = 0;
-      uint16_t    entryCount = 0;
-      uint8_t     indexLevel = 0;
-      uint8_t     reserved1[9] = {};   // must be zero
-
-      struct IndexPacketEntry
-      {
-            uint64_t    chunkRecordNumber = 0;
-            uint64_t    chunkPhysicalOffset = 0;
-      } entries[MAX_ENTRIES];
-
-      void        verify(unsigned bufferLength = 0, uint64_t totalRecordCount = 0, uint64_t fileSize = 0) const;
-
-#ifdef E57_DEBUG
-      void        dump(int indent = 0, std::ostream& os = std::cout) const;
-#endif
-};
-
 struct EmptyPacketHeader
 {
       const uint8_t     packetType = EMPTY_PACKET;
@@ -74,14 +49,25 @@ struct EmptyPacketHeader
 //=============================================================================
 // PacketReadCache
 
+constexpr unsigned PacketReadCache::noEntry;
+
 PacketReadCache::PacketReadCache(CheckedFile* cFile, unsigned packetCount)
    : cFile_(cFile),
+     packetCount_(packetCount),
      entries_(packetCount)
 {
    if (packetCount == 0)
    {
       throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "packetCount=" + toString(packetCount));
    }
+
+   index_.reserve(packetCount);
+
+   /// Start with all (empty) entries in the list
+   for ( unsigned i = 0; i < packetCount; ++i )
+   {
+      listInsert( i, false );
+   }
 }
 
 std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset, char* &pkt )
@@ -90,104 +76,215 @@ std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset,
    std::cout << "PacketReadCache::lock() called, packetLogicalOffset=" << packetLogicalOffset << std::endl;
 #endif
 
-   /// Only allow one locked packet at a time.
-   if ( lockCount_ > 0 )
-   {
-      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "lockCount=" + toString(lockCount_));
-   }
-
    /// Offset can't be 0
    if ( packetLogicalOffset == 0 )
    {
       throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "packetLogicalOffset=" + toString(packetLogicalOffset));
    }
 
-   /// Linear scan for matching packet offset in cache
-   for ( unsigned i = 0; i < entries_.size(); ++i )
+   std::unique_lock<std::mutex> guard( mutex_ );
+
+   for ( auto found = index_.find( packetLogicalOffset ); found != index_.end(); found = index_.find( packetLogicalOffset ) )
    {
-      auto  &entry = entries_[i];
+      const unsigned entryIndex = found->second;
+      auto  &entry = entries_[entryIndex];
 
-      if (packetLogicalOffset == entry.logicalOffset_)
+      /// Another thread is reading it.  Wait and look again, in case that failed.
+      if ( entry.loading_ )
       {
-         /// Found a match, so don't have to read anything
+         loaded_.wait( guard );
+         continue;
+      }
+
+      /// Found a match, so don't have to read anything
 #ifdef E57_MAX_VERBOSE
-         std::cout << "  Found matching cache entry, index=" << i << std::endl;
+      std::cout << "  Found matching cache entry, index=" << entryIndex << std::endl;
 #endif
-         /// Mark entry with current useCount (keeps track of age of entry).
-         entry.lastUsed_ = ++useCount_;
+      if ( entry.lockCount_++ == 0 )
+      {
+         listRemove( entryIndex );
+      }
 
-         /// Publish buffer address to caller
-         pkt = entry.buffer_;
+      /// Publish buffer address to caller
+      pkt = entry.buffer_.get();
 
-         /// Create lock so we are sure that we will be unlocked when use is finished.
-         std::unique_ptr<PacketLock> plock( new PacketLock( this, i ) );
+      /// Create lock so we are sure that we will be unlocked when use is finished.
+      return std::unique_ptr<PacketLock>( new PacketLock( this, entryIndex ) );
+   }
 
-         /// Increment cache lock just before return
-         ++lockCount_;
+   /// Get here if didn't find a match already in cache.
+   /// Reuse least recently used (LRU) unlocked entry, or add one if they are all locked.
+   unsigned entryIndex = oldest_;
+   if ( entryIndex == noEntry )
+   {
+      entryIndex = static_cast<unsigned>( entries_.size() );
+      entries_.emplace_back();
+   }
+   else
+   {
+      listRemove( entryIndex );
+   }
+#ifdef E57_MAX_VERBOSE
+   std::cout << "  Oldest entry=" << entryIndex << std::endl;
+#endif
 
-         return plock;
-      }
+   auto  &entry = entries_[entryIndex];
+
+   if ( entry.logicalOffset_ != 0 )
+   {
+      index_.erase( entry.logicalOffset_ );
    }
-   /// Get here if didn't find a match already in cache.
 
-   /// Find least recently used (LRU) packet buffer
-   unsigned oldestEntry = 0;
-   unsigned oldestUsed = entries_.at(0).lastUsed_;
+   if ( !entry.buffer_ )
+   {
+      entry.buffer_.reset( new char[DATA_PACKET_MAX] );
+      ++bufferCount_;
+   }
+
+   /// Claim entry, so other threads wanting the same packet wait for us
+   entry.logicalOffset_ = packetLogicalOffset;
+   entry.lockCount_ = 1;
+   entry.loading_ = true;
+   index_[packetLogicalOffset] = entryIndex;
+
+   char *buffer = entry.buffer_.get();
 
-   for ( unsigned i = 0; i < entries_.size(); ++i )
+   /// Read without holding mutex_, other threads can carry on with what is already in cache
+   guard.unlock();
+
+   try
+   {
+      readPacket( buffer, packetLogicalOffset );
+   }
+   catch (...)
    {
-      const auto  &entry = entries_[i];
+      guard.lock();
 
-      if ( entry.lastUsed_ < oldestUsed )
-      {
-         oldestEntry = i;
-         oldestUsed = entry.lastUsed_;
-      }
+      /// Give up entry, anybody waiting for it will try reading it themselves
+      index_.erase( packetLogicalOffset );
+      entries_[entryIndex].logicalOffset_ = 0;
+      entries_[entryIndex].loading_ = false;
+      entries_[entryIndex].lockCount_ = 0;
+      release( entryIndex );
+
+      loaded_.notify_all();
+      throw;
    }
-#ifdef E57_MAX_VERBOSE
-   std::cout << "  Oldest entry=" << oldestEntry << " lastUsed=" << oldestUsed << std::endl;
-#endif
 
-   readPacket(oldestEntry, packetLogicalOffset);
+   guard.lock();
+
+   entries_[entryIndex].loading_ = false;
+   loaded_.notify_all();
 
    /// Publish buffer address to caller
-   pkt = entries_[oldestEntry].buffer_;
+   pkt = buffer;
 
    /// Create lock so we are sure we will be unlocked when use is finished.
-   std::unique_ptr<PacketLock> plock( new PacketLock( this, oldestEntry ) );
-
-   /// Increment cache lock just before return
-   ++lockCount_;
-
-   return plock;
+   return std::unique_ptr<PacketLock>( new PacketLock( this, entryIndex ) );
 }
 
 void PacketReadCache::unlock(unsigned lockedEntry)
 {
-   //??? why lockedEntry not used?
 #ifdef E57_MAX_VERBOSE
    std::cout << "PacketReadCache::unlock() called, lockedEntry=" << lockedEntry << std::endl;
 #endif
 
-   if (lockCount_ != 1)
+   std::lock_guard<std::mutex> guard( mutex_ );
+
+   auto  &entry = entries_.at( lockedEntry );
+
+   if ( entry.lockCount_ == 0 )
+   {
+      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "lockedEntry=" + toString(lockedEntry));
+   }
+
+   if ( --entry.lockCount_ == 0 )
+   {
+      release( lockedEntry );
+   }
+}
+
+void PacketReadCache::release(unsigned entryIndex)
+{
+   /// Called with mutex_ held, when last lock of entry goes.  Drop buffers over budget as soon as we can.
+   auto  &entry = entries_[entryIndex];
+
+   if ( bufferCount_ > packetCount_ && entry.buffer_ )
+   {
+      if ( entry.logicalOffset_ != 0 )
+      {
+         index_.erase( entry.logicalOffset_ );
+         entry.logicalOffset_ = 0;
+      }
+
+      entry.buffer_.reset();
+      --bufferCount_;
+   }
+
+   /// Empty entries are the first to be reused
+   listInsert( entryIndex, entry.logicalOffset_ != 0 );
+}
+
+void PacketReadCache::listRemove(unsigned entryIndex)
+{
+   auto  &entry = entries_[entryIndex];
+
+   if ( entry.newer_ != noEntry )
    {
-      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "lockCount=" + toString(lockCount_));
+      entries_[entry.newer_].older_ = entry.older_;
+   }
+   else
+   {
+      newest_ = entry.older_;
+   }
+
+   if ( entry.older_ != noEntry )
+   {
+      entries_[entry.older_].newer_ = entry.newer_;
+   }
+   else
+   {
+      oldest_ = entry.newer_;
    }
 
-   --lockCount_;
+   entry.newer_ = noEntry;
+   entry.older_ = noEntry;
 }
 
-void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOffset)
+void PacketReadCache::listInsert(unsigned entryIndex, bool newest)
+{
+   auto  &entry = entries_[entryIndex];
+
+   if ( newest_ == noEntry )
+   {
+      /// List was empty
+      newest_ = entryIndex;
+      oldest_ = entryIndex;
+   }
+   else if ( newest )
+   {
+      entry.older_ = newest_;
+      entries_[newest_].newer_ = entryIndex;
+      newest_ = entryIndex;
+   }
+   else
+   {
+      entry.newer_ = oldest_;
+      entries_[oldest_].older_ = entryIndex;
+      oldest_ = entryIndex;
+   }
+}
+
+void PacketReadCache::readPacket(char* buffer, uint64_t packetLogicalOffset)
 {
 #ifdef E57_MAX_VERBOSE
-   std::cout << "PacketReadCache::readPacket() called, oldestEntry=" << oldestEntry << " packetLogicalOffset=" << packetLogicalOffset << std::endl;
+   std::cout << "PacketReadCache::readPacket() called, packetLogicalOffset=" << packetLogicalOffset << std::endl;
 #endif
 
    /// Read header of packet first to get length.  Use EmptyPacketHeader since it has the commom fields to all packets.
    EmptyPacketHeader header;
 
-   cFile_->seek(packetLogicalOffset, CheckedFile::Logical);
-   cFile_->read(reinterpret_cast<char*>(&header), sizeof(header));
+   cFile_->readAt(packetLogicalOffset, reinterpret_cast<char*>(&header), sizeof(header));
 
    /// Can't verify packet header here, because it is not really an EmptyPacketHeader.
    unsigned packetLength = header.packetLogicalLengthMinus1+1;
@@ -198,17 +295,14 @@ void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOff
       throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "packetLength=" + toString(packetLength));
    }
 
-   auto  &entry = entries_.at(oldestEntry);
-
-   /// Now read in whole packet into preallocated buffer_.  Note buffer is
-   cFile_->seek(packetLogicalOffset, CheckedFile::Logical);
-   cFile_->read(entry.buffer_, packetLength);
+   /// Now read in whole packet into buffer.
+   cFile_->readAt(packetLogicalOffset, buffer, packetLength);
 
    /// Verify that packet is good.
    switch (header.packetType)
    {
       case DATA_PACKET: {
-         auto dpkt = reinterpret_cast<DataPacket*>(entry.buffer_);
+         auto dpkt = reinterpret_cast<DataPacket*>(buffer);
 
          dpkt->verify(packetLength);
 #ifdef E57_MAX_VERBOSE
@@ -218,7 +312,7 @@ void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOff
       }
          break;
       case INDEX_PACKET: {
-         auto ipkt = reinterpret_cast<IndexPacket*>(entry.buffer_);
+         auto ipkt = reinterpret_cast<IndexPacket*>(buffer);
 
          ipkt->verify(packetLength);
 #ifdef E57_MAX_VERBOSE
@@ -228,7 +322,7 @@ void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOff
       }
          break;
       case EMPTY_PACKET: {
-         auto hp = reinterpret_cast<EmptyPacketHeader*>(entry.buffer_);
+         auto hp = reinterpret_cast<EmptyPacketHeader*>(buffer);
 
          hp->verify(packetLength);
 #ifdef E57_MAX_VERBOSE
@@ -240,45 +334,42 @@ void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOff
       default:
          throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "packetType=" + toString(header.packetType));
    }
-
-   entry.logicalOffset_ = packetLogicalOffset;
-
-   /// Mark entry with current useCount (keeps track of age of entry).
-   /// This is a cache, so a small hiccup when useCount_ overflows won't hurt.
-   entry.lastUsed_ = ++useCount_;
 }
 
 #ifdef E57_DEBUG
 void PacketReadCache::dump(int indent, std::ostream& os)
 {
-   os << space(indent) << "lockCount: " << lockCount_ << std::endl;
-   os << space(indent) << "useCount:  " << useCount_ << std::endl;
+   std::lock_guard<std::mutex> guard(mutex_);
+
+   os << space(indent) << "packetCount: " << packetCount_ << std::endl;
+   os << space(indent) << "bufferCount: " << bufferCount_ << std::endl;
    os << space(indent) << "entries:" << std::endl;
    for (unsigned i=0; i < entries_.size(); i++) {
       os << space(indent) << "entry[" << i << "]:" << std::endl;
       os << space(indent+4) << "logicalOffset:  " << entries_[i].logicalOffset_ << std::endl;
-      os << space(indent+4) << "lastUsed:        " << entries_[i].lastUsed_ << std::endl;
-      if (entries_[i].logicalOffset_ != 0) {
+      os << space(indent+4) << "lockCount:      " << entries_[i].lockCount_ << std::endl;
+      if (entries_[i].logicalOffset_ != 0 && !entries_[i].loading_) {
+         const char* buffer = entries_.at(i).buffer_.get();
          os << space(indent+4) << "packet:" << std::endl;
-         switch (reinterpret_cast<EmptyPacketHeader*>(entries_.at(i).buffer_)->packetType) {
+         switch (reinterpret_cast<const EmptyPacketHeader*>(buffer)->packetType) {
             case DATA_PACKET: {
-               auto dpkt = reinterpret_cast<DataPacket*>(entries_.at(i).buffer_);
+               auto dpkt = reinterpret_cast<const DataPacket*>(buffer);
                dpkt->dump(indent+6, os);
             }
                break;
             case INDEX_PACKET: {
-               auto ipkt = reinterpret_cast<IndexPacket*>(entries_.at(i).buffer_);
+               auto ipkt = reinterpret_cast<const IndexPacket*>(buffer);
                ipkt->dump(indent+6, os);
             }
                break;
             case EMPTY_PACKET: {
-               auto hp = reinterpret_cast<EmptyPacketHeader*>(entries_.at(i).buffer_);
+               auto hp = reinterpret_cast<const EmptyPacketHeader*>(buffer);
                hp->dump(indent+6, os);
             }
                break;
             default:
                throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
-                                    "packetType=" + toString(reinterpret_cast<EmptyPacketHeader*>(entries_.at(i).buffer_)->packetType));
+                                    "packetType=" + toString(reinterpret_cast<const EmptyPacketHeader*>(buffer)->packetType));
          }
       }
    }
@@ -310,6 +401,112 @@ PacketLock::~PacketLock()
    }
 }
 
+//=============================================================================
+// PacketPrefetcher
+
+PacketPrefetcher::PacketPrefetcher(std::shared_ptr<PacketReadCache> cache, uint64_t sectionEndLogicalOffset, unsigned packetCount)
+   : cache_(std::move(cache)),
+     sectionEndLogicalOffset_(sectionEndLogicalOffset),
+     packetCount_(packetCount),
+     thread_(&PacketPrefetcher::prefetchLoop, this)
+{
+}
+
+PacketPrefetcher::~PacketPrefetcher()
+{
+   stop();
+}
+
+void PacketPrefetcher::stop()
+{
+   {
+      std::lock_guard<std::mutex> guard(mutex_);
+      stopping_ = true;
+   }
+   moved_.notify_one();
+
+   if (thread_.joinable())
+   {
+      thread_.join();
+   }
+}
+
+void PacketPrefetcher::ahead(uint64_t packetLogicalOffset)
+{
+   {
+      std::lock_guard<std::mutex> guard(mutex_);
+
+      if (packetLogicalOffset == currentLogicalOffset_)
+      {
+         return;
+      }
+
+      currentLogicalOffset_ = packetLogicalOffset;
+   }
+   moved_.notify_one();
+}
+
+void PacketPrefetcher::prefetchLoop()
+{
+   std::unique_lock<std::mutex> guard(mutex_);
+
+   uint64_t walkedFrom = 0;   // value of currentLogicalOffset_ we last walked ahead of
+
+   while (true)
+   {
+      moved_.wait(guard, [&] { return stopping_ || currentLogicalOffset_ != walkedFrom; });
+
+      if (stopping_)
+      {
+         return;
+      }
+
+      walkedFrom = currentLogicalOffset_;
+
+      /// Walk the packets after the current one, the same way the reader will.  Packets already in cache cost little.
+      /// Start again from the top as soon as reader moves on.
+      uint64_t packetLogicalOffset = walkedFrom;
+      unsigned dataPacketCount = 0;
+
+      while (!stopping_ && currentLogicalOffset_ == walkedFrom && dataPacketCount <= packetCount_ &&
+             packetLogicalOffset < sectionEndLogicalOffset_)
+      {
+         guard.unlock();
+
+         unsigned packetType = 0;
+         unsigned packetLength = 0;
+         try
+         {
+            char* anyPacket = nullptr;
+            std::unique_ptr<PacketLock> packetLock = cache_->lock(packetLogicalOffset, anyPacket);
+
+            auto hp = reinterpret_cast<const EmptyPacketHeader*>(anyPacket);
+            packetType = hp->packetType;
+            packetLength = hp->packetLogicalLengthMinus1 + 1u;
+         }
+         catch (...)
+         {
+            /// Leave it to the reader to run into the bad packet and report it.
+            packetLength = 0;
+         }
+
+         guard.lock();
+
+         if (packetLength == 0)
+         {
+            break;
+         }
+
+         if (packetType == DATA_PACKET)
+         {
+            ++dataPacketCount;
+         }
+
+         packetLogicalOffset += packetLength;
+      }
+   }
+}
+
 //=============================================================================
 // DataPacketHeader
 
@@ -515,17 +712,25 @@ void DataPacket::dump(int indent, std::ostream& os) const
 //=============================================================================
 // IndexPacket
 
+/// These extra definitions are required in C++11.
+constexpr unsigned IndexPacket::MAX_ENTRIES;
+constexpr unsigned IndexPacket::HEADER_SIZE;
+
 void IndexPacket::verify(unsigned bufferLength, uint64_t totalRecordCount, uint64_t fileSize) const
 {
+   /// Double check that packet struct is correct length.  Watch out for RTTI increasing the size.
+   static_assert( sizeof( IndexPacket ) == HEADER_SIZE + MAX_ENTRIES*sizeof( IndexPacketEntry ), "Unexpected size of IndexPacket" );
+
    //??? do all packets need versions?  how extend without breaking older checking?  need to check file version#?
 
    /// Verify that packet is correct type
    if (packetType != INDEX_PACKET)
       throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "packetType=" + toString(packetType));
 
-   /// Check packetLength is at least large enough to hold header
+   /// Check packetLength is at least large enough to hold header.
+   /// Index packets are variable length, so only the fixed header part has to be present.
    unsigned packetLength = packetLogicalLengthMinus1+1;
-   if (packetLength < sizeof(*this))
+   if (packetLength < HEADER_SIZE)
       throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "packetLength=" + toString(packetLength));
 
    /// Check packet length is multiple of 4
@@ -564,7 +769,7 @@ void IndexPacket::verify(unsigned bufferLength, uint64_t totalRecordCount, uint6
    }
 
    /// Check if entries will fit in space provided
-   unsigned neededLength = 16 + 8*entryCount;
+   unsigned neededLength = HEADER_SIZE + sizeof(IndexPacketEntry)*entryCount;
    if (packetLength < neededLength) {
       throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
                            "packetLength=" + toString(packetLength)
@@ -26,7 +26,11 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "Common.h"
@@ -48,11 +52,22 @@ namespace e57
    /// maximum size of CompressedVector binary data packet
    constexpr int   DATA_PACKET_MAX = (64*1024);
 
+   /// Number of packets the readers of an ImageFile keep in memory, unless set with ImageFile::setPacketCacheSize()
+   constexpr unsigned   PACKET_CACHE_DEFAULT_COUNT = 32;
+
+   /// Number of data packets a reader loads ahead in the background, unless set with ImageFile::setPacketPrefetchCount()
+   constexpr unsigned   PACKET_PREFETCH_DEFAULT_COUNT = 0;
+
+   /// Packets read from the binary sections of one ImageFile, shared by all its CompressedVectorReaders.
+   /// Safe to use from several threads at once.
    class PacketReadCache
    {
       public:
+         /// Keeps up to packetCount packets, but only allocates a buffer for an entry once it is used
          PacketReadCache(CheckedFile* cFile, unsigned packetCount);
 
+         /// Any number of packets can be locked at once, the same one by several locks.  Locked packets are never evicted,
+         /// so if all are locked the cache goes over packetCount until enough are unlocked again.
          std::unique_ptr<PacketLock> lock(uint64_t packetLogicalOffset, char* &pkt);  //??? pkt could be const
 
 #ifdef E57_DEBUG
@@ -64,20 +79,39 @@ namespace e57
          friend class PacketLock;
          void                unlock(unsigned cacheIndex);
 
-         void                readPacket(unsigned oldestEntry, uint64_t packetLogicalOffset);
+         void                readPacket(char* buffer, uint64_t packetLogicalOffset);
+         void                release(unsigned entryIndex);
+         void                listRemove(unsigned entryIndex);
+         void                listInsert(unsigned entryIndex, bool newest);
+
+         /// Marks the ends of the LRU list
+         static constexpr unsigned  noEntry = ~0U;
 
          struct CacheEntry
          {
-               uint64_t    logicalOffset_ = 0;
-               char        buffer_[DATA_PACKET_MAX];  //! No need to init since it's a data buffer
-               unsigned    lastUsed_ = 0;
+               uint64_t    logicalOffset_ = 0;        // 0 if entry doesn't hold a packet
+               std::unique_ptr<char[]> buffer_;     //! DATA_PACKET_MAX long, allocated on first use.  No need to init since it's a data buffer
+               unsigned    lockCount_ = 0;          // entry is in LRU list only when this is zero
+               bool        loading_ = false;        // packet is being read by thread that locked it first
+               unsigned    newer_ = noEntry;        // neighbours in LRU list
+               unsigned    older_ = noEntry;
          };
 
-         unsigned    lockCount_ = 0;
-         unsigned    useCount_ = 0;
          CheckedFile *cFile_ = nullptr;
+         unsigned    packetCount_ = 0;           // most buffers kept once they are unlocked
+         unsigned    bufferCount_ = 0;           // buffers allocated
+
+         std::mutex  mutex_;                     // guards everything below
+         std::condition_variable  loaded_;       // an entry finished loading
 
          std::vector<CacheEntry>  entries_;
+
+         /// Which entry holds (or is loading) the packet at a logical offset
+         std::unordered_map<uint64_t, unsigned>  index_;
+
+         /// Ends of the list of unlocked entries, in order of use
+         unsigned    newest_ = noEntry;
+         unsigned    oldest_ = noEntry;
    };
 
    class PacketLock
@@ -99,6 +133,38 @@ namespace e57
          unsigned int     cacheIndex_ = 0;
    };
 
+   /// Background thread that reads the data packets following the one a reader is at into a PacketReadCache,
+   /// so decoding the current packet overlaps with reading (and verifying) the next ones.
+   class PacketPrefetcher
+   {
+      public:
+         PacketPrefetcher(std::shared_ptr<PacketReadCache> cache, uint64_t sectionEndLogicalOffset, unsigned packetCount);
+         ~PacketPrefetcher();
+
+         /// Reader is now using the packet at packetLogicalOffset, start loading the packetCount data packets after it
+         void        ahead(uint64_t packetLogicalOffset);
+
+         /// Wait for the thread to finish the packet in hand and end it.  Nothing is loaded after, ahead() does nothing.
+         void        stop();
+
+      private:
+         PacketPrefetcher(const PacketPrefetcher&) = delete;
+         PacketPrefetcher& operator=(const PacketPrefetcher&) = delete;
+
+         void        prefetchLoop();
+
+         std::shared_ptr<PacketReadCache> cache_;
+         const uint64_t    sectionEndLogicalOffset_;
+         const unsigned    packetCount_;
+
+         std::mutex                 mutex_;             // guards everything below
+         std::condition_variable    moved_;             // reader moved, or we are stopping
+         uint64_t                   currentLogicalOffset_ = 0;  // packet reader is at, 0 before first ahead()
+         bool                       stopping_ = false;
+
+         std::thread                thread_;            // last, so it starts after everything above is ready
+   };
+
    class DataPacketHeader
    {
       public:
@@ -137,5 +203,31 @@ namespace e57
 
          uint8_t     payload[PayloadSize];  //! No need to init since it's a data buffer
    };
+
+   struct IndexPacket
+   {
+         static constexpr unsigned MAX_ENTRIES = 2048;
+         static constexpr unsigned HEADER_SIZE = 16;
+
+         const uint8_t     packetType = INDEX_PACKET;
+
+         uint8_t     packetFlags = 0;    // flag bitfields
+         uint16_t    packetLogicalLengthMinus1 = 0;
+         uint16_t    entryCount = 0;
+         uint8_t     indexLevel = 0;
+         uint8_t     reserved1[9] = {};   // must be zero
+
+         struct IndexPacketEntry
+         {
+               uint64_t    chunkRecordNumber = 0;
+               uint64_t    chunkPhysicalOffset = 0;
+         } entries[MAX_ENTRIES];
+
+         void        verify(unsigned bufferLength = 0, uint64_t totalRecordCount = 0, uint64_t fileSize = 0) const;
+
+#ifdef E57_DEBUG
+         void        dump(int indent = 0, std::ostream& os = std::cout) const;
+#endif
+   };
 }
 #endif
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "E57FormatImpl.h"
+#include "ImageFileImpl.h"
+#include "PointBlockImpl.h"
+
+using namespace e57;
+using namespace std;
+
+constexpr size_t PointBlockImpl::columnAlignment;
+
+PointBlockImpl::PointBlockImpl( ImageFileImplWeakPtr destImageFile, size_t capacity )
+   : destImageFile_( destImageFile ),
+     capacity_( capacity )
+{
+   ImageFileImplSharedPtr imf( destImageFile_ );
+   if ( !imf->isOpen() )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_IMAGEFILE_NOT_OPEN, "fileName=" + imf->fileName() );
+   }
+
+   if ( capacity == 0 )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "fileName=" + imf->fileName() + " capacity=0" );
+   }
+}
+
+size_t PointBlockImpl::elementSize( MemoryRepresentation representation )
+{
+   switch ( representation )
+   {
+      case E57_INT8:    return sizeof(int8_t);
+      case E57_UINT8:   return sizeof(uint8_t);
+      case E57_INT16:   return sizeof(int16_t);
+      case E57_UINT16:  return sizeof(uint16_t);
+      case E57_INT32:   return sizeof(int32_t);
+      case E57_UINT32:  return sizeof(uint32_t);
+      case E57_INT64:   return sizeof(int64_t);
+      case E57_BOOL:    return sizeof(bool);
+      case E57_REAL32:  return sizeof(float);
+      case E57_REAL64:  return sizeof(double);
+      case E57_USTRING: return 0;
+   }
+
+   throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "memoryRepresentation=" + toString( representation ) );
+}
+
+void PointBlockImpl::addPrototypeColumns( const NodeImplSharedPtr &prototype )
+{
+   addTerminalColumns( prototype, prototype );
+}
+
+void PointBlockImpl::addTerminalColumns( const NodeImplSharedPtr &node, const NodeImplSharedPtr &origin )
+{
+   /// Structures and Vectors: columns for each child, in order
+   shared_ptr<StructureNodeImpl> structure( dynamic_pointer_cast<StructureNodeImpl>( node ) );
+   if ( structure )
+   {
+      for ( int64_t i = 0; i < structure->childCount(); i++ )
+      {
+         addTerminalColumns( structure->get( i ), origin );
+      }
+      return;
+   }
+
+   const ustring pathName = node->relativePathName( origin );
+
+   switch ( node->type() )
+   {
+      case E57_INTEGER:
+         addColumn( pathName, E57_INT64, false, false );
+         break;
+
+      case E57_SCALED_INTEGER:
+         addColumn( pathName, E57_REAL64, true, true );
+         break;
+
+      case E57_FLOAT:
+      {
+         shared_ptr<FloatNodeImpl> fi( dynamic_pointer_cast<FloatNodeImpl>( node ) );
+         addColumn( pathName, ( fi->precision() == E57_SINGLE ) ? E57_REAL32 : E57_REAL64, false, false );
+         break;
+      }
+
+      case E57_STRING:
+         addColumn( pathName, E57_USTRING, false, false );
+         break;
+
+      default:
+         throw E57_EXCEPTION2( E57_ERROR_BAD_PROTOTYPE, "pathName=" + pathName + " nodeType=" + toString( node->type() ) );
+   }
+}
+
+size_t PointBlockImpl::addColumn( const ustring &pathName, MemoryRepresentation representation,
+                                  bool doConversion, bool doScaling )
+{
+   for ( const auto &buffer : buffers_ )
+   {
+      if ( buffer.pathName() == pathName )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_BUFFER_DUPLICATE_PATHNAME, "pathName=" + pathName );
+      }
+   }
+
+   const size_t size = elementSize( representation );
+
+   Column column;
+   column.representation = representation;
+
+   if ( representation == E57_USTRING )
+   {
+      column.strings.reset( new StringList( capacity_ ) );
+   }
+   else
+   {
+      /// Zero filled, so a partly written block never holds garbage
+      column.storage.reset( new char[capacity_ * size + columnAlignment - 1]() );
+
+      const uintptr_t address = reinterpret_cast<uintptr_t>( column.storage.get() );
+      column.data = column.storage.get() + ( columnAlignment - address % columnAlignment ) % columnAlignment;
+   }
+
+   /// Describe the column once here, readers and writers reuse these without looking at the path name again
+   ImageFileImplSharedPtr destImageFile( destImageFile_ );
+   ImageFile imf( destImageFile );
+   char* data = column.data;
+
+   switch ( representation )
+   {
+      case E57_INT8:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<int8_t*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_UINT8:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<uint8_t*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_INT16:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<int16_t*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_UINT16:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<uint16_t*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_INT32:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<int32_t*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_UINT32:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<uint32_t*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_INT64:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<int64_t*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_BOOL:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<bool*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_REAL32:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<float*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_REAL64:
+         buffers_.emplace_back( imf, pathName, reinterpret_cast<double*>( data ), capacity_, doConversion, doScaling );
+         break;
+      case E57_USTRING:
+         buffers_.emplace_back( imf, pathName, column.strings.get() );
+         break;
+   }
+
+   columns_.push_back( std::move( column ) );
+
+   return columns_.size() - 1;
+}
+
+size_t PointBlockImpl::columnIndex( const ustring &pathName ) const
+{
+   for ( size_t i = 0; i < buffers_.size(); i++ )
+   {
+      if ( buffers_[i].pathName() == pathName )
+      {
+         return i;
+      }
+   }
+
+   throw E57_EXCEPTION2( E57_ERROR_PATH_UNDEFINED, "pathName=" + pathName );
+}
+
+ustring PointBlockImpl::columnPathName( size_t index ) const
+{
+   column( index );
+   return buffers_[index].pathName();
+}
+
+MemoryRepresentation PointBlockImpl::columnRepresentation( size_t index ) const
+{
+   return column( index ).representation;
+}
+
+void* PointBlockImpl::columnData( size_t index ) const
+{
+   return column( index ).data;
+}
+
+StringList* PointBlockImpl::columnStrings( size_t index ) const
+{
+   return column( index ).strings.get();
+}
+
+const PointBlockImpl::Column& PointBlockImpl::column( size_t index ) const
+{
+   if ( index >= columns_.size() )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "index=" + toString( index ) + " columnCount=" + toString( columns_.size() ) );
+   }
+
+   return columns_[index];
+}
+
+#ifdef E57_DEBUG
+void PointBlockImpl::dump( int indent, ostream& os ) const
+{
+   os << space( indent ) << "capacity:    " << capacity_ << endl;
+   os << space( indent ) << "columnCount: " << columns_.size() << endl;
+   for ( size_t i = 0; i < buffers_.size(); i++ )
+   {
+      os << space( indent ) << "column[" << i << "]:" << endl;
+      buffers_[i].dump( indent + 4, os );
+   }
+}
+#endif
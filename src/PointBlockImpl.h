@@ -0,0 +1,86 @@
+#ifndef POINTBLOCKIMPL_H
+#define POINTBLOCKIMPL_H
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Common.h"
+
+namespace e57
+{
+   /// Owns one aligned array per field, and the SourceDestBuffers describing them, which are built once when a column is
+   /// added and then handed to any number of readers and writers.
+   class PointBlockImpl
+   {
+      public:
+         /// Column arrays start on a cache line boundary
+         static constexpr size_t columnAlignment = 64;
+
+         /// Bytes per element of a column, 0 for E57_USTRING
+         static size_t  elementSize( MemoryRepresentation representation );
+
+         PointBlockImpl( ImageFileImplWeakPtr destImageFile, size_t capacity );
+
+         /// Add a column for every terminal node below prototype, in the representation that holds its values exactly
+         void           addPrototypeColumns( const NodeImplSharedPtr &prototype );
+
+         size_t         addColumn( const ustring &pathName, MemoryRepresentation representation,
+                                   bool doConversion, bool doScaling );
+
+         size_t         capacity() const { return capacity_; }
+         size_t         columnCount() const { return columns_.size(); }
+         size_t         columnIndex( const ustring &pathName ) const;
+         ustring        columnPathName( size_t index ) const;
+         MemoryRepresentation columnRepresentation( size_t index ) const;
+         void*          columnData( size_t index ) const;
+         StringList*    columnStrings( size_t index ) const;
+
+         /// One SourceDestBuffer per column, in column order
+         const std::vector<SourceDestBuffer>& buffers() const { return buffers_; }
+
+#ifdef E57_DEBUG
+         void           dump( int indent = 0, std::ostream& os = std::cout ) const;
+#endif
+
+      private:
+         struct Column
+         {
+            MemoryRepresentation         representation;
+            std::unique_ptr<char[]>      storage;          /// Allocation holding data, with room to align it
+            char*                        data = nullptr;   /// First element, on a columnAlignment boundary
+            std::unique_ptr<StringList>  strings;          /// Used instead of data by E57_USTRING columns
+         };
+
+         void           addTerminalColumns( const NodeImplSharedPtr &node, const NodeImplSharedPtr &origin );
+         const Column&  column( size_t index ) const;
+
+         ImageFileImplWeakPtr            destImageFile_;
+         size_t                          capacity_;
+         std::vector<Column>             columns_;
+         std::vector<SourceDestBuffer>   buffers_;
+   };
+}
+
+#endif
@@ -24,14 +24,46 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <limits>
 
+#include "BitUnpack.h"
 #include "ImageFileImpl.h"
 #include "SourceDestBufferImpl.h"
 
 using namespace e57;
 using namespace std;
 
+namespace
+{
+    /// Smallest and largest of count values, count > 0
+    template<typename V>
+    void minMax( const V* values, size_t count, V& lo, V& hi )
+    {
+        lo = hi = values[0];
+        for (size_t i = 1; i < count; i++) {
+            lo = min(lo, values[i]);
+            hi = max(hi, values[i]);
+        }
+    }
+
+    /// True if all of [lo, hi] can be stored in a T
+    template<typename T, typename V>
+    bool fits( V lo, V hi )
+    {
+        return(static_cast<V>(numeric_limits<T>::lowest()) <= lo && hi <= static_cast<V>(numeric_limits<T>::max()));
+    }
+
+    template<typename T>
+    bool fits( const int64_t* values, size_t count )
+    {
+        int64_t lo, hi;
+        minMax(values, count, lo, hi);
+        return(fits<T>(lo, hi));
+    }
+}
 
 SourceDestBufferImpl::SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile, const ustring &pathName, const size_t capacity, bool doConversion, bool doScaling )
    : destImageFile_( destImageFile ),
@@ -195,6 +227,210 @@ void SourceDestBufferImpl::_setNextReal( T inValue )
    nextIndex_++;
 }
 
+template<typename T, typename Convert>
+void SourceDestBufferImpl::_setNextBlock( size_t count, Convert convert )
+{
+   /// Caller has checked there is room and that all values are representable
+   char* p = &base_[nextIndex_*stride_];
+
+   if (stride_ == sizeof(T)) {
+      /// Contiguous, a loop the compiler can vectorize
+      T* dest = reinterpret_cast<T*>(p);
+      for (size_t i = 0; i < count; i++)
+         dest[i] = static_cast<T>(convert(i));
+   } else {
+      for (size_t i = 0; i < count; i++, p += stride_)
+         *reinterpret_cast<T*>(p) = static_cast<T>(convert(i));
+   }
+
+   nextIndex_ += static_cast<unsigned>(count);
+}
+
+template<typename T>
+void SourceDestBufferImpl::_setNextReals( const T* values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   if (count == 0)
+      return;
+
+   /// Verify have room
+   if (count > capacity_ - nextIndex_)
+      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+   auto value = [values](size_t i) { return values[i]; };
+
+   switch (memoryRepresentation_) {
+      case E57_REAL32:
+         if ( std::is_same<T, double>::value ) {
+            /// Same check as _setNextReal()
+            T lo, hi;
+            minMax(values, count, lo, hi);
+            if (lo < E57_DOUBLE_MIN || E57_DOUBLE_MAX < hi)
+               break;
+         }
+         _setNextBlock<float>(count, value);
+         return;
+      case E57_REAL64:
+         _setNextBlock<double>(count, value);
+         return;
+      default:
+         break;
+   }
+
+   /// Conversions to integers, and values that fail a check (which throws at the right value), go one at a time
+   for (size_t i = 0; i < count; i++)
+      _setNextReal(values[i]);
+}
+
+template<typename T>
+void SourceDestBufferImpl::_setNextRealBytes( const char* bytes, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   if (count == 0)
+      return;
+
+   /// Verify have room
+   if (count > capacity_ - nextIndex_)
+      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+   const MemoryRepresentation sameType = std::is_same<T, float>::value ? E57_REAL32 : E57_REAL64;
+
+   if (memoryRepresentation_ == sameType && stride_ == sizeof(T)) {
+      memcpy(&base_[nextIndex_*stride_], bytes, count*sizeof(T));
+      nextIndex_ += static_cast<unsigned>(count);
+      return;
+   }
+
+   /// Otherwise copy to aligned values a block at a time, and convert those
+   const size_t blockSize = 256;
+   T values[blockSize];
+
+   for (size_t done = 0; done < count; ) {
+      const size_t blockCount = min(count - done, blockSize);
+      memcpy(values, &bytes[done*sizeof(T)], blockCount*sizeof(T));
+
+      _setNextReals(values, blockCount);
+      done += blockCount;
+   }
+}
+
+template<typename T, typename V>
+void SourceDestBufferImpl::_getNextBlock( V* values, size_t count ) const
+{
+   /// Caller has checked there are enough values, and moves nextIndex_ on once it has checked them
+   const char* p = &base_[nextIndex_*stride_];
+
+   if (stride_ == sizeof(T)) {
+      /// Contiguous, a loop the compiler can vectorize
+      const T* source = reinterpret_cast<const T*>(p);
+      for (size_t i = 0; i < count; i++)
+         values[i] = static_cast<V>(source[i]);
+   } else {
+      for (size_t i = 0; i < count; i++, p += stride_)
+         values[i] = static_cast<V>(*reinterpret_cast<const T*>(p));
+   }
+}
+
+template<typename V>
+bool SourceDestBufferImpl::_getNextValues( V* values, size_t count ) const
+{
+   /// Plain conversion of any numeric representation, caller decides whether conversion is allowed
+   switch (memoryRepresentation_) {
+      case E57_INT8:
+         _getNextBlock<int8_t>(values, count);
+         return true;
+      case E57_UINT8:
+         _getNextBlock<uint8_t>(values, count);
+         return true;
+      case E57_INT16:
+         _getNextBlock<int16_t>(values, count);
+         return true;
+      case E57_UINT16:
+         _getNextBlock<uint16_t>(values, count);
+         return true;
+      case E57_INT32:
+         _getNextBlock<int32_t>(values, count);
+         return true;
+      case E57_UINT32:
+         _getNextBlock<uint32_t>(values, count);
+         return true;
+      case E57_INT64:
+         _getNextBlock<int64_t>(values, count);
+         return true;
+      case E57_BOOL:
+         /// Converts to 0/1
+         _getNextBlock<bool>(values, count);
+         return true;
+      case E57_REAL32:
+         _getNextBlock<float>(values, count);
+         return true;
+      case E57_REAL64:
+         _getNextBlock<double>(values, count);
+         return true;
+      default:
+         return false;
+   }
+}
+
+template<typename T>
+void SourceDestBufferImpl::_getNextReals( T* values, size_t count )
+{
+   static_assert( std::is_same<T, double>::value || std::is_same<T, float>::value,
+                  "_getNextReals() requires float or double type" );
+
+   /// don't checkImageFileOpen
+
+   if (count == 0)
+      return;
+
+   /// Verify have enough values
+   if (count > capacity_ - nextIndex_)
+      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+   if (std::is_same<T, float>::value && memoryRepresentation_ == E57_REAL64) {
+      /// Same check as getNextFloat(), on a block of doubles at a time
+      const size_t blockSize = 256;
+      double doubles[blockSize];
+
+      for (size_t done = 0; done < count; ) {
+         const size_t blockCount = min(count - done, blockSize);
+         T* blockValues = &values[done];
+
+         _getNextValues(doubles, blockCount);
+
+         double lo, hi;
+         minMax(doubles, blockCount, lo, hi);
+
+         if (E57_DOUBLE_MIN <= lo && hi <= E57_DOUBLE_MAX) {
+            for (size_t i = 0; i < blockCount; i++)
+               blockValues[i] = static_cast<T>(doubles[i]);
+            nextIndex_ += static_cast<unsigned>(blockCount);
+         } else {
+            /// Let the single value version throw at the right value
+            for (size_t i = 0; i < blockCount; i++)
+               blockValues[i] = getNextFloat();
+         }
+
+         done += blockCount;
+      }
+      return;
+   }
+
+   /// Integers need conversion turned on, reals don't
+   const bool isReal = (memoryRepresentation_ == E57_REAL32 || memoryRepresentation_ == E57_REAL64);
+
+   if ((!isReal && !doConversion_) || !_getNextValues(values, count)) {
+      /// Let the single value version throw the right error
+      for (size_t i = 0; i < count; i++)
+         values[i] = std::is_same<T, float>::value ? getNextFloat() : static_cast<T>(getNextDouble());
+      return;
+   }
+
+   nextIndex_ += static_cast<unsigned>(count);
+}
+
 void SourceDestBufferImpl::checkState_() const
 {
     /// Implement checkImageFileOpen functionality for SourceDestBufferImpl ctors
@@ -375,6 +611,87 @@ int64_t SourceDestBufferImpl::getNextInt64(double scale, double offset)
     return(rawValue);
 }
 
+void SourceDestBufferImpl::getNextInt64(int64_t* values, size_t count)
+{
+    /// don't checkImageFileOpen
+
+    if (count == 0)
+        return;
+
+    /// Verify have enough values
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+    bool needsConversion = (memoryRepresentation_ == E57_BOOL || memoryRepresentation_ == E57_REAL32 ||
+                            memoryRepresentation_ == E57_REAL64);
+
+    if ((needsConversion && !doConversion_) || !_getNextValues(values, count)) {
+        /// Let the single value version throw the right error
+        for (size_t i = 0; i < count; i++)
+            values[i] = getNextInt64();
+        return;
+    }
+
+    nextIndex_ += static_cast<unsigned>(count);
+}
+
+void SourceDestBufferImpl::getNextInt64(int64_t* values, size_t count, double scale, double offset)
+{
+    /// don't checkImageFileOpen
+
+    if (!doScaling_) {
+        /// Just return raw values.
+        getNextInt64(values, count);
+        return;
+    }
+
+    /// Double check non-zero scale.  Going to divide by it below.
+    if (scale == 0)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+    if (count == 0)
+        return;
+
+    /// Verify have enough values
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+    /// Every representation is converted to double first, then reverse scaled with the same arithmetic as the single value version
+    const size_t blockSize = 256;
+    double doubleRawValues[blockSize];
+
+    bool needsConversion = (memoryRepresentation_ == E57_REAL32 || memoryRepresentation_ == E57_REAL64);
+
+    for (size_t done = 0; done < count; ) {
+        const size_t blockCount = min(count - done, blockSize);
+        int64_t* blockValues = &values[done];
+
+        bool ok = !(needsConversion && !doConversion_) && _getNextValues(doubleRawValues, blockCount);
+
+        if (ok) {
+            /// Calc (x-offset)/scale rounded to nearest integer, then make sure the whole block is representable in an int64_t
+            for (size_t i = 0; i < blockCount; i++)
+                doubleRawValues[i] = floor((doubleRawValues[i] - offset)/scale + 0.5);
+
+            double lo, hi;
+            minMax(doubleRawValues, blockCount, lo, hi);
+            ok = (E57_INT64_MIN <= lo && hi <= E57_INT64_MAX);
+        }
+
+        if (ok) {
+            for (size_t i = 0; i < blockCount; i++)
+                blockValues[i] = static_cast<int64_t>(doubleRawValues[i]);
+            nextIndex_ += static_cast<unsigned>(blockCount);
+        } else {
+            /// Let the single value version throw the right error at the right value
+            for (size_t i = 0; i < blockCount; i++)
+                blockValues[i] = getNextInt64(scale, offset);
+        }
+
+        done += blockCount;
+    }
+}
+
 float SourceDestBufferImpl::getNextFloat()
 {
     /// don't checkImageFileOpen
@@ -521,6 +838,16 @@ double SourceDestBufferImpl::getNextDouble()
     return(value);
 }
 
+void SourceDestBufferImpl::getNextFloat(float* values, size_t count)
+{
+    _getNextReals(values, count);
+}
+
+void SourceDestBufferImpl::getNextDouble(double* values, size_t count)
+{
+    _getNextReals(values, count);
+}
+
 ustring SourceDestBufferImpl::getNextString()
 {
     /// don't checkImageFileOpen
@@ -702,6 +1029,230 @@ void SourceDestBufferImpl::setNextDouble(double value)
     _setNextReal( value );
 }
 
+void SourceDestBufferImpl::setNextInt64(const int64_t* values, size_t count)
+{
+    /// don't checkImageFileOpen
+
+    if (count == 0)
+        return;
+
+    /// Verify have room
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+    auto value = [values](size_t i) { return values[i]; };
+
+    switch (memoryRepresentation_) {
+        case E57_INT8:
+            if (!fits<int8_t>(values, count))
+                break;
+            _setNextBlock<int8_t>(count, value);
+            return;
+        case E57_UINT8:
+            if (!fits<uint8_t>(values, count))
+                break;
+            _setNextBlock<uint8_t>(count, value);
+            return;
+        case E57_INT16:
+            if (!fits<int16_t>(values, count))
+                break;
+            _setNextBlock<int16_t>(count, value);
+            return;
+        case E57_UINT16:
+            if (!fits<uint16_t>(values, count))
+                break;
+            _setNextBlock<uint16_t>(count, value);
+            return;
+        case E57_INT32:
+            if (!fits<int32_t>(values, count))
+                break;
+            _setNextBlock<int32_t>(count, value);
+            return;
+        case E57_UINT32:
+            if (!fits<uint32_t>(values, count))
+                break;
+            _setNextBlock<uint32_t>(count, value);
+            return;
+        case E57_INT64:
+            _setNextBlock<int64_t>(count, value);
+            return;
+        case E57_REAL32:
+            if (!doConversion_)
+                break;
+            _setNextBlock<float>(count, value);
+            return;
+        case E57_REAL64:
+            if (!doConversion_)
+                break;
+            _setNextBlock<double>(count, value);
+            return;
+        default:
+            break;
+    }
+
+    /// Bools, strings and values that fail a check (which throws at the right value) go one at a time
+    for (size_t i = 0; i < count; i++)
+        setNextInt64(values[i]);
+}
+
+void SourceDestBufferImpl::setNextInt64(const int64_t* values, size_t count, double scale, double offset)
+{
+    /// don't checkImageFileOpen
+
+    if (!doScaling_) {
+        /// Use raw value routine, then bail out.
+        setNextInt64(values, count);
+        return;
+    }
+
+    if (count == 0)
+        return;
+
+    /// Verify have room
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+    /// Same arithmetic as the single value version, floating point results keep full resolution, integers are rounded
+    auto scaled = [=](size_t i) { return values[i]*scale + offset; };
+    auto rounded = [=](size_t i) { return floor(values[i]*scale + offset + 0.5); };
+
+    /// x*scale+offset is monotonic, so the smallest and largest raw values give the range of the results
+    int64_t lo, hi;
+    minMax(values, count, lo, hi);
+    double scaledLo = lo*scale + offset;
+    double scaledHi = hi*scale + offset;
+    if (scaledHi < scaledLo)
+        swap(scaledLo, scaledHi);
+    double roundedLo = floor(scaledLo + 0.5);
+    double roundedHi = floor(scaledHi + 0.5);
+
+    switch (memoryRepresentation_) {
+        case E57_INT8:
+            if (!fits<int8_t>(roundedLo, roundedHi))
+                break;
+            _setNextBlock<int8_t>(count, rounded);
+            return;
+        case E57_UINT8:
+            if (!fits<uint8_t>(roundedLo, roundedHi))
+                break;
+            _setNextBlock<uint8_t>(count, rounded);
+            return;
+        case E57_INT16:
+            if (!fits<int16_t>(roundedLo, roundedHi))
+                break;
+            _setNextBlock<int16_t>(count, rounded);
+            return;
+        case E57_UINT16:
+            if (!fits<uint16_t>(roundedLo, roundedHi))
+                break;
+            _setNextBlock<uint16_t>(count, rounded);
+            return;
+        case E57_INT32:
+            if (!fits<int32_t>(roundedLo, roundedHi))
+                break;
+            _setNextBlock<int32_t>(count, rounded);
+            return;
+        case E57_UINT32:
+            if (!fits<uint32_t>(roundedLo, roundedHi))
+                break;
+            _setNextBlock<uint32_t>(count, rounded);
+            return;
+        case E57_INT64:
+            _setNextBlock<int64_t>(count, rounded);
+            return;
+        case E57_REAL32:
+            if (!doConversion_ || scaledLo < E57_DOUBLE_MIN || E57_DOUBLE_MAX < scaledHi)
+                break;
+            _setNextBlock<float>(count, scaled);
+            return;
+        case E57_REAL64:
+            if (!doConversion_)
+                break;
+            _setNextBlock<double>(count, scaled);
+            return;
+        default:
+            break;
+    }
+
+    /// Bools, strings and values that fail a check (which throws at the right value) go one at a time
+    for (size_t i = 0; i < count; i++)
+        setNextInt64(values[i], scale, offset);
+}
+
+void SourceDestBufferImpl::setNextFloatBytes(const char* bytes, size_t count)
+{
+    _setNextRealBytes<float>( bytes, count );
+}
+
+void SourceDestBufferImpl::setNextDoubleBytes(const char* bytes, size_t count)
+{
+    _setNextRealBytes<double>( bytes, count );
+}
+
+void SourceDestBufferImpl::setNextScaledInt64(int64_t minimum, const uint32_t* raw, size_t count, double scale, double offset)
+{
+    /// don't checkImageFileOpen
+
+    if (count == 0)
+        return;
+
+    /// Verify have room
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+    /// Kernel adds minimum in double, which is exact while it is well inside the 53 bit mantissa
+    const int64_t exactLimit = 1LL << 52;
+
+    if (doScaling_ && doConversion_ && -exactLimit < minimum && minimum < exactLimit) {
+        char* p = &base_[nextIndex_*stride_];
+
+        if (memoryRepresentation_ == E57_REAL64 && stride_ == sizeof(double)) {
+            scaleUnpacked(raw, count, minimum, scale, offset, reinterpret_cast<double*>(p));
+            nextIndex_ += static_cast<unsigned>(count);
+            return;
+        }
+
+        if (memoryRepresentation_ == E57_REAL32 && stride_ == sizeof(float)) {
+            /// Same check as setNextInt64(value, scale, offset), on the extreme values
+            uint32_t lo, hi;
+            minMax(raw, count, lo, hi);
+            double scaledLo = (minimum + static_cast<int64_t>(lo))*scale + offset;
+            double scaledHi = (minimum + static_cast<int64_t>(hi))*scale + offset;
+            if (scaledHi < scaledLo)
+                swap(scaledLo, scaledHi);
+
+            if (E57_DOUBLE_MIN <= scaledLo && scaledHi <= E57_DOUBLE_MAX) {
+                scaleUnpacked(raw, count, minimum, scale, offset, reinterpret_cast<float*>(p));
+                nextIndex_ += static_cast<unsigned>(count);
+                return;
+            }
+        }
+    }
+
+    /// Everything else goes through the int64 bulk setter, a block at a time
+    const size_t blockSize = 256;
+    int64_t values[blockSize];
+
+    for (size_t done = 0; done < count; ) {
+        const size_t blockCount = min(count - done, blockSize);
+        for (size_t i = 0; i < blockCount; i++)
+            values[i] = minimum + static_cast<int64_t>(raw[done + i]);
+
+        setNextInt64(values, blockCount, scale, offset);
+        done += blockCount;
+    }
+}
+
+void SourceDestBufferImpl::setNextFloat(const float* values, size_t count)
+{
+    _setNextReals( values, count );
+}
+
+void SourceDestBufferImpl::setNextDouble(const double* values, size_t count)
+{
+    _setNextReals( values, count );
+}
+
 void SourceDestBufferImpl::setNextString(const ustring& value)
 {
     /// don't checkImageFileOpen
@@ -68,6 +68,29 @@ namespace e57
          void            setNextDouble(double value);
          void            setNextString(const ustring& value);
 
+         /// Fetch count values at once, with the same checks and conversions as count calls of the single value versions.
+         /// The memory representation is switched on once per call, and contiguous buffers are read by a plain array loop.
+         void            getNextInt64(int64_t* values, size_t count);
+         void            getNextInt64(int64_t* values, size_t count, double scale, double offset);
+         void            getNextFloat(float* values, size_t count);
+         void            getNextDouble(double* values, size_t count);
+
+         /// Store count values at once, with the same checks and conversions as count calls of the single value versions.
+         /// The memory representation is switched on once per call, and contiguous buffers are filled by a plain array loop.
+         void            setNextInt64(const int64_t* values, size_t count);
+         void            setNextInt64(const int64_t* values, size_t count, double scale, double offset);
+         void            setNextFloat(const float* values, size_t count);
+         void            setNextDouble(const double* values, size_t count);
+
+         /// Same as setNextFloat/setNextDouble(values, count), from values stored back to back with any alignment, as they
+         /// are in a bytestream.  A contiguous buffer of the same type is filled by one memcpy.
+         void            setNextFloatBytes(const char* bytes, size_t count);
+         void            setNextDoubleBytes(const char* bytes, size_t count);
+
+         /// Same as setNextInt64(values, count, scale, offset) with values[i] = minimum + raw[i], for unpacked ScaledInteger
+         /// values.  Contiguous float and double buffers are filled straight from raw in one vectorized pass.
+         void            setNextScaledInt64(int64_t minimum, const uint32_t* raw, size_t count, double scale, double offset);
+
          void            checkCompatible( const std::shared_ptr<SourceDestBufferImpl> &newBuf ) const;
 
 #ifdef E57_DEBUG
@@ -78,6 +101,24 @@ namespace e57
          template<typename T>
          void _setNextReal( T inValue );
 
+         template<typename T>
+         void _setNextReals( const T* values, size_t count );
+
+         template<typename T>
+         void _setNextRealBytes( const char* bytes, size_t count );
+
+         template<typename T, typename Convert>
+         void _setNextBlock( size_t count, Convert convert );
+
+         template<typename T, typename V>
+         void _getNextBlock( V* values, size_t count ) const;
+
+         template<typename V>
+         bool _getNextValues( V* values, size_t count ) const;
+
+         template<typename T>
+         void _getNextReals( T* values, size_t count );
+
          void checkState_() const;  /// Common routine to check that constructor arguments were ok, throws if not
 
          //??? verify alignment
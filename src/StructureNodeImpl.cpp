@@ -60,7 +60,7 @@ bool StructureNodeImpl::isTypeEquivalent(NodeImplSharedPtr ni)
     if (!si)  // check if failed
         throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "this->pathName=" + this->pathName() + " elementName="+ni->elementName());
 
-    /// Same number of children?
+    /// Same number of children?  Parses both if they were read lazily.
     if (childCount() != si->childCount())
         return(false);
 
@@ -107,11 +107,15 @@ int64_t StructureNodeImpl::childCount() const
 {
     checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
 
+    /// Parsing children left from a lazy read doesn't change what the node looks like from outside
+    const_cast<StructureNodeImpl*>(this)->materialize();
+
     return children_.size();
 }
 NodeImplSharedPtr StructureNodeImpl::get(int64_t index)
 {
     checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+    materialize();
         if (index < 0 || index >= static_cast<int64_t>(children_.size())) { // %%% Possible truncation on platforms where size_t = uint64
         throw E57_EXCEPTION2(E57_ERROR_CHILD_INDEX_OUT_OF_BOUNDS,
                              "this->pathName=" + this->pathName()
@@ -136,6 +140,8 @@ NodeImplSharedPtr StructureNodeImpl::lookup(const ustring& pathName)
 {
     /// don't checkImageFileOpen
     //??? use lookup(fields, level) instead, for speed.
+    materialize();
+
     bool isRelative;
     vector<ustring> fields;
     ImageFileImplSharedPtr imf(destImageFile_);
@@ -185,6 +191,7 @@ NodeImplSharedPtr StructureNodeImpl::lookup(const ustring& pathName)
 void StructureNodeImpl::set(int64_t index64, NodeImplSharedPtr ni)
 {
     checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+    materialize();
 
     auto index = static_cast<unsigned>(index64);
 
@@ -260,6 +267,7 @@ void StructureNodeImpl::set(const vector<ustring>& fields, unsigned level, NodeI
 #endif
 
     checkImageFileOpen(__FILE__, __LINE__, static_cast<const char *>(__FUNCTION__));
+    materialize();
     //??? check if field is numeric string (e.g. "17"), verify number is same as index, else throw bad_path
 
     /// Check if trying to set the root node "/", which is illegal
@@ -325,6 +333,7 @@ void StructureNodeImpl::append(NodeImplSharedPtr ni)
 void StructureNodeImpl::checkLeavesInSet(const StringSet &pathNames, NodeImplSharedPtr origin)
 {
     /// don't checkImageFileOpen
+    materialize();
 
     /// Not a leaf node, so check all our children
     for ( auto &child : children_ )
@@ -337,6 +346,7 @@ void StructureNodeImpl::checkLeavesInSet(const StringSet &pathNames, NodeImplSha
 void StructureNodeImpl::writeXml(ImageFileImplSharedPtr imf, CheckedFile& cf, int indent, const char* forcedFieldName)
 {
     /// don't checkImageFileOpen
+    materialize();
 
     ustring fieldName;
     if (forcedFieldName != nullptr)
@@ -381,11 +391,39 @@ void StructureNodeImpl::writeXml(ImageFileImplSharedPtr imf, CheckedFile& cf, in
     }
 }
 
+void StructureNodeImpl::setUnparsedChildren(size_t extent)
+{
+    /// don't checkImageFileOpen
+    hasUnparsedChildren_ = true;
+    unparsedExtent_ = extent;
+}
+
+void StructureNodeImpl::materialize()
+{
+    /// Parse the children left by a lazy read, the first time they are needed
+    if (!hasUnparsedChildren_)
+        return;
+
+    /// Parsing adds the children with set(), which comes back here
+    hasUnparsedChildren_ = false;
+
+    try {
+        ImageFileImplSharedPtr imf(destImageFile_);
+        imf->parseChildren(static_pointer_cast<StructureNodeImpl>(shared_from_this()), unparsedExtent_);
+    } catch (...) {
+        /// Leave them unparsed, so the next use fails the same way
+        children_.clear();
+        hasUnparsedChildren_ = true;
+        throw;
+    }
+}
+
 //??? use visitor?
 #ifdef E57_DEBUG
 void StructureNodeImpl::dump(int indent, ostream& os) const
 {
     /// don't checkImageFileOpen
+    const_cast<StructureNodeImpl*>(this)->materialize();
     os << space(indent) << "type:        Structure" << " (" << type() << ")" << endl;
     NodeImpl::dump(indent, os);
     for (unsigned i = 0; i < children_.size(); i++) {
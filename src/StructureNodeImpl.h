@@ -55,6 +55,9 @@ public:
 
     void        writeXml(ImageFileImplSharedPtr imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) override;
 
+    /// In an ImageFile read lazily, leave the children to be parsed from extent of its XML index when first used
+    void        setUnparsedChildren(size_t extent);
+
 #ifdef E57_DEBUG
     void    dump(int indent = 0, std::ostream& os = std::cout) const override;
 #endif
@@ -63,7 +66,12 @@ protected:
     friend class CompressedVectorReaderImpl;
     NodeImplSharedPtr lookup(const ustring& pathName) override;
 
+    void        materialize();
+
     std::vector<NodeImplSharedPtr> children_;
+
+    bool        hasUnparsedChildren_ = false;
+    size_t      unparsedExtent_ = 0;
 };
 
 }
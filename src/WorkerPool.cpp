@@ -0,0 +1,156 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "WorkerPool.h"
+
+using namespace e57;
+using namespace std;
+
+WorkerPool::WorkerPool(unsigned threadCount)
+{
+   /// Caller of parallelFor() is one of the workers, so start one less thread
+   for (unsigned i = 1; i < threadCount; i++)
+   {
+      threads_.emplace_back(&WorkerPool::workerLoop, this);
+   }
+}
+
+WorkerPool::~WorkerPool()
+{
+   {
+      lock_guard<mutex> lock(mutex_);
+      stopping_ = true;
+   }
+   workAvailable_.notify_all();
+
+   for (auto &thread : threads_)
+   {
+      thread.join();
+   }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t minChunkSize, const RangeTask& task)
+{
+   if (count == 0)
+   {
+      return;
+   }
+
+   /// Not worth waking anybody for a small job
+   const size_t chunkSize = max(minChunkSize, (count + threadCount() - 1) / threadCount());
+   if (threads_.empty() || chunkSize >= count)
+   {
+      task(0, count);
+      return;
+   }
+
+   Job job;
+   job.task = &task;
+   job.count = count;
+   job.chunkSize = chunkSize;
+   job.chunkCount = (count + chunkSize - 1) / chunkSize;
+
+   unique_lock<mutex> lock(mutex_);
+   jobs_.push_back(&job);
+   workAvailable_.notify_all();
+
+   /// Help out until every chunk has been started, then wait for the others to finish theirs
+   while (runChunk(lock, &job))
+   {
+   }
+
+   job.finished.wait(lock, [&job] { return job.finishedChunks == job.chunkCount; });
+
+   if (job.error)
+   {
+      rethrow_exception(job.error);
+   }
+}
+
+void WorkerPool::workerLoop()
+{
+   unique_lock<mutex> lock(mutex_);
+
+   while (true)
+   {
+      workAvailable_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+
+      if (stopping_)
+      {
+         return;
+      }
+
+      runChunk(lock, jobs_.front());
+   }
+}
+
+bool WorkerPool::runChunk(unique_lock<mutex>& lock, Job* job)
+{
+   /// Called with lock held, returns with it held.  Returns false if job had no chunks left to start.
+   if (job->nextChunk >= job->chunkCount)
+   {
+      return false;
+   }
+
+   const size_t chunk = job->nextChunk++;
+
+   /// Once its last chunk is handed out, job is no longer offered to workers.  Caller keeps it alive until all finish.
+   if (job->nextChunk == job->chunkCount)
+   {
+      jobs_.erase(std::find(jobs_.begin(), jobs_.end(), job));
+   }
+
+   const size_t begin = chunk * job->chunkSize;
+   const size_t end = min(begin + job->chunkSize, job->count);
+
+   lock.unlock();
+
+   exception_ptr error;
+   try
+   {
+      (*job->task)(begin, end);
+   }
+   catch (...)
+   {
+      error = current_exception();
+   }
+
+   lock.lock();
+
+   if (error && !job->error)
+   {
+      job->error = error;
+   }
+
+   if (++job->finishedChunks == job->chunkCount)
+   {
+      job->finished.notify_all();
+   }
+
+   return true;
+}
@@ -0,0 +1,82 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace e57
+{
+   /// Fixed set of threads that split up loops over independent items.
+   /// Can be shared, parallelFor() may be called from several threads at once.
+   class WorkerPool
+   {
+      public:
+         using RangeTask = std::function<void(size_t begin, size_t end)>;
+
+         explicit WorkerPool(unsigned threadCount);
+         ~WorkerPool();
+
+         /// Number of threads that work on a parallelFor(), including the caller
+         unsigned    threadCount() const { return static_cast<unsigned>(threads_.size()) + 1; }
+
+         /// Call task on consecutive sub-ranges of [0, count), at least minChunkSize long, on the pool threads and the
+         /// calling thread.  Returns when all are done.  If any call throws, the first exception is rethrown here.
+         void        parallelFor(size_t count, size_t minChunkSize, const RangeTask& task);
+
+      private:
+         WorkerPool(const WorkerPool&) = delete;
+         WorkerPool& operator=(const WorkerPool&) = delete;
+
+         struct Job
+         {
+               const RangeTask*   task = nullptr;
+               size_t             count = 0;
+               size_t             chunkSize = 0;
+               size_t             chunkCount = 0;
+               size_t             nextChunk = 0;        // next chunk not yet started
+               size_t             finishedChunks = 0;
+               std::exception_ptr error;
+               std::condition_variable finished;
+         };
+
+         void        workerLoop();
+         bool        runChunk(std::unique_lock<std::mutex>& lock, Job* job);
+
+         std::vector<std::thread>   threads_;
+         std::mutex                 mutex_;           // guards everything below, and all Job fields
+         std::condition_variable    workAvailable_;
+         std::deque<Job*>           jobs_;            // jobs with chunks not yet started
+         bool                       stopping_ = false;
+   };
+}
+
+#endif
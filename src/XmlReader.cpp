@@ -0,0 +1,1057 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "CheckedFile.h"
+#include "XmlReader.h"
+
+using namespace e57;
+using namespace std;
+
+namespace
+{
+   /// Bytes read from the file at a time, a whole number of logical pages
+   constexpr size_t readChunkSize = 64 * CheckedFile::logicalPageSize;
+
+   const ustring xmlnsUri = "http://www.w3.org/2000/xmlns/";
+   const ustring xmlUri = "http://www.w3.org/XML/1998/namespace";
+   const ustring noUri;
+
+   /// Bytes the scanning loops stop at
+   enum : uint8_t
+   {
+      tagSpecial = 1,         // in a tag
+      textSpecial = 2,        // in text, to expand or normalize
+      attributeSpecial = 4    // in an attribute value, to expand or normalize
+   };
+
+   struct CharClasses
+   {
+      uint8_t table[256] = {};
+
+      CharClasses()
+      {
+         for (unsigned char c : {'>', '"', '\'', '<', '[', ']'})
+         {
+            table[c] |= tagSpecial;
+         }
+         for (unsigned char c : {'&', '\r'})
+         {
+            table[c] |= textSpecial | attributeSpecial;
+         }
+         for (unsigned char c : {'<', '\t', '\n'})
+         {
+            table[c] |= attributeSpecial;
+         }
+      }
+   };
+
+   inline const uint8_t* charClasses()
+   {
+      static const CharClasses classes;
+      return classes.table;
+   }
+
+   inline bool isSpace(char c)
+   {
+      return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+   }
+
+   inline const char* skipSpace(const char* p, const char* end)
+   {
+      while (p < end && isSpace(*p))
+      {
+         p++;
+      }
+      return p;
+   }
+
+   /// Split qName at its colon, if it has one
+   void splitName(const ustring& qName, ustring& prefix, ustring& localName)
+   {
+      const size_t colon = qName.find(':');
+      if (colon == ustring::npos)
+      {
+         prefix.clear();
+         localName = qName;
+      }
+      else
+      {
+         prefix.assign(qName, 0, colon);
+         localName.assign(qName, colon + 1, ustring::npos);
+      }
+   }
+
+   /// Move line and column on past the characters from p to end
+   void countLines(const char* p, const char* end, uint64_t& line, uint64_t& column)
+   {
+      for (; p < end; p++)
+      {
+         if (*p == '\n')
+         {
+            line++;
+            column = 1;
+         }
+         else
+         {
+            column++;
+         }
+      }
+   }
+
+   void appendUtf8(uint32_t c, ustring& out)
+   {
+      if (c < 0x80)
+      {
+         out += static_cast<char>(c);
+      }
+      else if (c < 0x800)
+      {
+         out += static_cast<char>(0xC0 | (c >> 6));
+         out += static_cast<char>(0x80 | (c & 0x3F));
+      }
+      else if (c < 0x10000)
+      {
+         out += static_cast<char>(0xE0 | (c >> 12));
+         out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+         out += static_cast<char>(0x80 | (c & 0x3F));
+      }
+      else
+      {
+         out += static_cast<char>(0xF0 | (c >> 18));
+         out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+         out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+         out += static_cast<char>(0x80 | (c & 0x3F));
+      }
+   }
+}
+
+XmlReader::XmlReader(CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength)
+   : cf_(cf),
+     sectionStart_(logicalStart),
+     nextOffset_(logicalStart),
+     remaining_(logicalLength),
+     buffer_(readChunkSize),
+     bufferOffset_(logicalStart)
+{
+}
+
+XmlReader::XmlReader(CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength, XmlIndex& index)
+   : XmlReader(cf, logicalStart, logicalLength)
+{
+   newIndex_ = &index;
+   newIndex_->sectionStart = logicalStart;
+}
+
+XmlReader::XmlReader(CheckedFile* cf, const XmlIndex& index, size_t extent)
+   : XmlReader(cf, index.extents.at(extent).contentStart, index.extents[extent].contentEnd - index.extents[extent].contentStart)
+{
+   sectionStart_ = index.sectionStart;
+   fragmentIndex_ = &index;
+   nextExtent_ = extent + 1;
+   bindings_ = index.namespaces;
+
+   /// Already inside the root element
+   rootSeen_ = true;
+}
+
+void XmlReader::parse(E57XmlParser& handler)
+{
+   readMore();
+
+   /// Skip a UTF-8 byte order mark
+   if (fragmentIndex_ == nullptr && end_ >= 3 && memcmp(buffer_.data(), "\xEF\xBB\xBF", 3) == 0)
+   {
+      begin_ = 3;
+   }
+
+   bool atStart = (fragmentIndex_ == nullptr);
+
+   while (begin_ < end_ || readMore())
+   {
+      if (buffer_[begin_] != '<')
+      {
+         /// Text runs up to the next tag, or the end of the section
+         size_t length = find(0, "<");
+         length = (length == string::npos) ? end_ - begin_ : length - 1;
+
+         const char* p = buffer_.data() + begin_;
+         parseText(handler, p, p + length, true);
+         begin_ += length;
+         atStart = false;
+         continue;
+      }
+
+      /// Make sure the longest markup opening, "<![CDATA[", is in the buffer
+      while (end_ - begin_ < 9 && readMore())
+      {
+      }
+
+      const char* p = buffer_.data() + begin_;
+      const size_t available = end_ - begin_;
+      size_t length = 0;
+      bool contentToCome = false;
+
+      if (available >= 4 && memcmp(p, "<!--", 4) == 0)
+      {
+         length = find(4, "-->");
+
+         p = buffer_.data() + begin_;
+         if (length == string::npos)
+         {
+            error(p, "comment not terminated");
+         }
+      }
+      else if (available >= 9 && memcmp(p, "<![CDATA[", 9) == 0)
+      {
+         length = find(9, "]]>");
+
+         p = buffer_.data() + begin_;
+         if (length == string::npos)
+         {
+            error(p, "CDATA section not terminated");
+         }
+         if (depth_ == 0 && fragmentIndex_ == nullptr)
+         {
+            error(p, "CDATA section outside the root element");
+         }
+         parseText(handler, p + 9, p + length - 3, false);
+      }
+      else if (available >= 2 && p[1] == '?')
+      {
+         length = find(2, "?>");
+
+         p = buffer_.data() + begin_;
+         if (length == string::npos)
+         {
+            error(p, "processing instruction not terminated");
+         }
+         if (length >= 7 && memcmp(p, "<?xml", 5) == 0 && isSpace(p[5]))
+         {
+            if (!atStart)
+            {
+               error(p, "XML declaration not at the start of the document");
+            }
+            parseDeclaration(p, p + length);
+         }
+      }
+      else if (available >= 2 && p[1] == '!')
+      {
+         length = tagLength(true);
+
+         p = buffer_.data() + begin_;
+         if (length < 9 || memcmp(p, "<!DOCTYPE", 9) != 0)
+         {
+            error(p, "unrecognized markup");
+         }
+         if (rootSeen_)
+         {
+            error(p, "document type declaration after the root element");
+         }
+      }
+      else if (available >= 2 && p[1] == '/')
+      {
+         length = tagLength(false);
+         parseEndTag(handler, buffer_.data() + begin_, buffer_.data() + begin_ + length);
+      }
+      else
+      {
+         length = tagLength(false);
+
+         p = buffer_.data() + begin_;
+         if (depth_ == 0 && rootSeen_ && fragmentIndex_ == nullptr)
+         {
+            error(p, "more than one root element");
+         }
+         rootSeen_ = true;
+         contentToCome = parseStartTag(handler, p, p + length);
+      }
+
+      begin_ += length;
+      atStart = false;
+
+      if (contentToCome && (newIndex_ != nullptr || fragmentIndex_ != nullptr))
+      {
+         offerContent(handler);
+      }
+   }
+
+   if (depth_ > 0)
+   {
+      error(nullptr, "element " + open_[depth_ - 1].qName + " not ended");
+   }
+
+   if (!rootSeen_)
+   {
+      error(nullptr, "no root element");
+   }
+}
+
+bool XmlReader::readMore()
+{
+   if (remaining_ == 0)
+   {
+      return false;
+   }
+
+   /// Drop the bytes already parsed
+   if (begin_ > 0)
+   {
+      memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+      bufferOffset_ += begin_;
+      end_ -= begin_;
+      begin_ = 0;
+   }
+
+   /// Markup too long for the buffer
+   if (end_ == buffer_.size())
+   {
+      buffer_.resize(2 * buffer_.size());
+   }
+
+   const size_t count = static_cast<size_t>(min<uint64_t>(remaining_, buffer_.size() - end_));
+
+   cf_->readAt(nextOffset_, buffer_.data() + end_, count);
+
+   nextOffset_ += count;
+   remaining_ -= count;
+   end_ += count;
+
+   return true;
+}
+
+size_t XmlReader::find(size_t from, const char* terminator)
+{
+   /// Returns the offset from begin_ just past the first terminator at or after begin_ + from, npos if there is none
+   const size_t terminatorLength = strlen(terminator);
+
+   while (true)
+   {
+      const char* first = buffer_.data() + begin_;
+      const char* last = buffer_.data() + end_;
+
+      const char* found = (terminatorLength == 1) ? std::find(first + min(from, end_ - begin_), last, *terminator)
+                                                  : search(first + min(from, end_ - begin_), last, terminator, terminator + terminatorLength);
+      if (found != last)
+      {
+         return (found - first) + terminatorLength;
+      }
+
+      /// Start the next search where the rest of a partial match could be
+      if (end_ - begin_ >= terminatorLength)
+      {
+         from = max(from, end_ - begin_ - terminatorLength + 1);
+      }
+
+      if (!readMore())
+      {
+         return string::npos;
+      }
+   }
+}
+
+size_t XmlReader::tagLength(bool allowBrackets)
+{
+   /// Returns the length of the tag at begin_, up to the first '>' not in quotes (or brackets, in a DOCTYPE)
+   const uint8_t* classes = charClasses();
+   char quote = 0;
+   int bracketDepth = 0;
+   size_t scanned = 1;
+
+   while (true)
+   {
+      if (begin_ + scanned == end_ && !readMore())
+      {
+         error(buffer_.data() + begin_, "tag not terminated");
+      }
+
+      const char* first = buffer_.data() + begin_;
+      const char* last = buffer_.data() + end_;
+      const char* p = first + scanned;
+
+      while (p < last)
+      {
+         if (quote != 0)
+         {
+            const char* closingQuote = static_cast<const char*>(memchr(p, quote, last - p));
+            if (closingQuote == nullptr)
+            {
+               break;
+            }
+            quote = 0;
+            p = closingQuote + 1;
+            continue;
+         }
+
+         while (p < last && (classes[static_cast<uint8_t>(*p)] & tagSpecial) == 0)
+         {
+            p++;
+         }
+         if (p == last)
+         {
+            break;
+         }
+
+         const char c = *p;
+         if (c == '>' && bracketDepth <= 0)
+         {
+            return (p - first) + 1;
+         }
+         else if (c == '"' || c == '\'')
+         {
+            quote = c;
+         }
+         else if (c == '<' && !allowBrackets)
+         {
+            error(p, "'<' in tag");
+         }
+         else if (c == '[' && allowBrackets)
+         {
+            bracketDepth++;
+         }
+         else if (c == ']' && allowBrackets)
+         {
+            bracketDepth--;
+         }
+         p++;
+      }
+
+      scanned = end_ - begin_;
+   }
+}
+
+void XmlReader::parseDeclaration(const char* p, const char* end)
+{
+   /// Only the encoding matters, the version and standalone pseudo-attributes are ignored
+   const char* encoding = search(p, end, "encoding", "encoding" + 8);
+   if (encoding == end)
+   {
+      return;
+   }
+
+   const char* q = skipSpace(encoding + 8, end);
+   if (q == end || *q != '=')
+   {
+      error(q, "bad encoding declaration");
+   }
+
+   q = skipSpace(q + 1, end);
+   if (q == end || (*q != '"' && *q != '\''))
+   {
+      error(q, "bad encoding declaration");
+   }
+
+   const char* valueEnd = find_if(q + 1, end, [q](char c) { return c == *q; });
+
+   ustring value(q + 1, valueEnd);
+   transform(value.begin(), value.end(), value.begin(), [](char c) { return static_cast<char>(toupper(c)); });
+
+   if (value != "UTF-8" && value != "UTF8" && value != "US-ASCII")
+   {
+      error(q, "encoding " + ustring(q + 1, valueEnd) + " not supported, only UTF-8");
+   }
+}
+
+bool XmlReader::parseStartTag(E57XmlParser& handler, const char* p, const char* end)
+{
+   /// p is the '<' and end is just past the '>'.  Returns false for an empty element, which is ended here too.
+   const char* nameEnd = p + 1;
+   while (!isSpace(*nameEnd) && *nameEnd != '/' && *nameEnd != '>')
+   {
+      nameEnd++;
+   }
+   if (nameEnd == p + 1)
+   {
+      error(p, "missing element name");
+   }
+
+   attributes_.clear();
+
+   const char* q = nameEnd;
+   bool isEmpty = false;
+
+   while (true)
+   {
+      const char* name = skipSpace(q, end);
+      if (*name == '>')
+      {
+         break;
+      }
+      if (*name == '/')
+      {
+         if (name[1] != '>')
+         {
+            error(name, "expected '>' after '/'");
+         }
+         isEmpty = true;
+         break;
+      }
+      if (name == q)
+      {
+         error(name, "expected whitespace before attribute");
+      }
+
+      const char* attributeNameEnd = name;
+      while (!isSpace(*attributeNameEnd) && *attributeNameEnd != '=' && *attributeNameEnd != '/' && *attributeNameEnd != '>')
+      {
+         attributeNameEnd++;
+      }
+
+      const char* value = skipSpace(attributeNameEnd, end);
+      if (attributeNameEnd == name || *value != '=')
+      {
+         error(value, "expected attribute name and '='");
+      }
+
+      value = skipSpace(value + 1, end);
+      if (*value != '"' && *value != '\'')
+      {
+         error(value, "attribute value not quoted");
+      }
+
+      const char* valueEnd = static_cast<const char*>(memchr(value + 1, *value, end - (value + 1)));
+      if (valueEnd == nullptr)
+      {
+         error(value, "attribute value not terminated");
+      }
+
+      attributes_.emplace_back();
+      XmlAttribute& attribute = attributes_.back();
+      attribute.qName.assign(name, attributeNameEnd);
+      decode(value + 1, valueEnd, true, true, attribute.value);
+
+      for (size_t i = 0; i + 1 < attributes_.size(); i++)
+      {
+         if (attributes_[i].qName == attribute.qName)
+         {
+            error(name, "attribute " + attribute.qName + " given twice");
+         }
+      }
+
+      q = valueEnd + 1;
+   }
+
+   if (depth_ == open_.size())
+   {
+      open_.emplace_back();
+   }
+
+   OpenElement& element = open_[depth_++];
+   element.qName.assign(p + 1, nameEnd);
+   element.bindingCount = bindings_.size();
+
+   /// Namespace declarations apply to the element they are on, so bind them before resolving any prefix
+   for (XmlAttribute& attribute : attributes_)
+   {
+      if (attribute.qName.compare(0, 5, "xmlns") != 0)
+      {
+         continue;
+      }
+
+      if (attribute.qName.length() == 5)
+      {
+         bindings_.push_back({"", attribute.value});
+         attribute.localName = attribute.qName;
+         attribute.uri.clear();
+      }
+      else if (attribute.qName[5] == ':')
+      {
+         attribute.localName.assign(attribute.qName, 6, ustring::npos);
+         attribute.uri = xmlnsUri;
+         bindings_.push_back({attribute.localName, attribute.value});
+      }
+   }
+
+   ustring prefix;
+   for (XmlAttribute& attribute : attributes_)
+   {
+      if (attribute.qName.compare(0, 5, "xmlns") == 0 && (attribute.qName.length() == 5 || attribute.qName[5] == ':'))
+      {
+         continue;
+      }
+
+      splitName(attribute.qName, prefix, attribute.localName);
+
+      /// Attributes without a prefix are in no namespace, not the default one
+      attribute.uri = prefix.empty() ? noUri : resolvePrefix(p, prefix);
+   }
+
+   splitName(element.qName, prefix, element.localName);
+   element.uri = resolvePrefix(p, prefix);
+
+   handler.startElement(element.uri, element.localName, element.qName, attributes_);
+
+   if (isEmpty)
+   {
+      endElement(handler);
+   }
+
+   return !isEmpty;
+}
+
+void XmlReader::parseEndTag(E57XmlParser& handler, const char* p, const char* end)
+{
+   /// p is the '<' of "</" and end is just past the '>'
+   const char* name = p + 2;
+   const char* nameEnd = name;
+   while (!isSpace(*nameEnd) && *nameEnd != '>')
+   {
+      nameEnd++;
+   }
+
+   if (skipSpace(nameEnd, end) != end - 1)
+   {
+      error(nameEnd, "expected '>' after end tag name");
+   }
+
+   if (depth_ == 0)
+   {
+      error(p, "end tag without start tag");
+   }
+
+   const ustring& qName = open_[depth_ - 1].qName;
+   if (qName.compare(0, ustring::npos, name, nameEnd - name) != 0)
+   {
+      error(p, "end tag " + ustring(name, nameEnd) + " does not match start tag " + qName);
+   }
+
+   endElement(handler);
+}
+
+void XmlReader::endElement(E57XmlParser& handler)
+{
+   const OpenElement& element = open_[depth_ - 1];
+
+   handler.endElement(element.uri, element.localName, element.qName);
+
+   bindings_.erase(bindings_.begin() + element.bindingCount, bindings_.end());
+   depth_--;
+}
+
+void XmlReader::offerContent(E57XmlParser& handler)
+{
+   /// begin_ is just past the start tag of an element that is not empty.  If the handler takes the content of the
+   /// element to parse later, skip over it to the end tag.
+   const uint64_t contentStart = bufferOffset_ + begin_;
+
+   if (fragmentIndex_ != nullptr)
+   {
+      /// Only elements with child elements have an extent
+      const vector<XmlExtent>& extents = fragmentIndex_->extents;
+      if (nextExtent_ == extents.size() || extents[nextExtent_].contentStart != contentStart)
+      {
+         return;
+      }
+
+      const size_t extent = nextExtent_;
+      if (!handler.deferChildren(extent))
+      {
+         nextExtent_++;
+         return;
+      }
+
+      nextExtent_ += 1 + extents[extent].descendants;
+      skipTo(extents[extent]);
+      return;
+   }
+
+   vector<XmlExtent>& extents = newIndex_->extents;
+   const size_t extent = extents.size();
+
+   extents.emplace_back();
+   extents.back().contentStart = contentStart;
+
+   if (!handler.deferChildren(extent))
+   {
+      extents.pop_back();
+      return;
+   }
+
+   if (extent == 0)
+   {
+      newIndex_->namespaces = bindings_;
+   }
+
+   skim(extent);
+}
+
+void XmlReader::skim(size_t extent)
+{
+   /// Skip the content of the element of extent up to its end tag, noting the extents of the elements in it that have
+   /// child elements.  Only the nesting of elements is checked here, the rest is left to when they are parsed.
+   vector<XmlExtent>& extents = newIndex_->extents;
+   size_t depth = 0;
+
+   while (true)
+   {
+      if (begin_ == end_ && !readMore())
+      {
+         error(nullptr, "element " + open_[depth_ - 1].qName + " not ended");
+      }
+
+      if (buffer_[begin_] != '<')
+      {
+         const size_t length = find(0, "<");
+         begin_ += (length == string::npos) ? end_ - begin_ : length - 1;
+         continue;
+      }
+
+      while (end_ - begin_ < 9 && readMore())
+      {
+      }
+
+      const char* p = buffer_.data() + begin_;
+      const size_t available = end_ - begin_;
+      size_t length = 0;
+
+      if (available >= 4 && memcmp(p, "<!--", 4) == 0)
+      {
+         length = find(4, "-->");
+         if (length == string::npos)
+         {
+            error(buffer_.data() + begin_, "comment not terminated");
+         }
+      }
+      else if (available >= 9 && memcmp(p, "<![CDATA[", 9) == 0)
+      {
+         length = find(9, "]]>");
+         if (length == string::npos)
+         {
+            error(buffer_.data() + begin_, "CDATA section not terminated");
+         }
+      }
+      else if (available >= 2 && p[1] == '?')
+      {
+         length = find(2, "?>");
+         if (length == string::npos)
+         {
+            error(buffer_.data() + begin_, "processing instruction not terminated");
+         }
+      }
+      else if (available >= 2 && p[1] == '!')
+      {
+         error(p, "unrecognized markup");
+      }
+      else if (available >= 2 && p[1] == '/')
+      {
+         length = tagLength(false);
+
+         p = buffer_.data() + begin_;
+         const char* name = p + 2;
+         const char* nameEnd = name;
+         while (!isSpace(*nameEnd) && *nameEnd != '>')
+         {
+            nameEnd++;
+         }
+
+         /// The end tag of the element of extent is left for parse() to check
+         if (depth == 0)
+         {
+            XmlExtent& content = extents[extent];
+            content.contentEnd = bufferOffset_ + begin_;
+            content.descendants = extents.size() - extent - 1;
+            return;
+         }
+
+         const SkimmedElement& element = skimmed_[--depth];
+         if (element.qName.compare(0, ustring::npos, name, nameEnd - name) != 0 || skipSpace(nameEnd, p + length) != p + length - 1)
+         {
+            error(p, "end tag " + ustring(name, nameEnd) + " does not match start tag " + element.qName);
+         }
+
+         if (element.extent != string::npos)
+         {
+            XmlExtent& nested = extents[element.extent];
+            nested.contentEnd = bufferOffset_ + begin_;
+            nested.descendants = extents.size() - element.extent - 1;
+         }
+      }
+      else
+      {
+         length = tagLength(false);
+
+         p = buffer_.data() + begin_;
+         const char* nameEnd = p + 1;
+         while (!isSpace(*nameEnd) && *nameEnd != '/' && *nameEnd != '>')
+         {
+            nameEnd++;
+         }
+         if (nameEnd == p + 1)
+         {
+            error(p, "missing element name");
+         }
+
+         /// The element this one is in has child elements, so it needs an extent
+         if (depth > 0 && skimmed_[depth - 1].extent == string::npos)
+         {
+            SkimmedElement& parent = skimmed_[depth - 1];
+            parent.extent = extents.size();
+
+            extents.emplace_back();
+            extents.back().contentStart = parent.contentStart;
+         }
+
+         if (p[length - 2] != '/')
+         {
+            if (depth == skimmed_.size())
+            {
+               skimmed_.emplace_back();
+            }
+
+            SkimmedElement& element = skimmed_[depth++];
+            element.qName.assign(p + 1, nameEnd);
+            element.extent = string::npos;
+            element.contentStart = bufferOffset_ + begin_ + length;
+         }
+      }
+
+      begin_ += length;
+   }
+}
+
+void XmlReader::skipTo(const XmlExtent& extent)
+{
+   /// Continue at the end of the content of extent, without reading what is before it if it is not read yet
+   if (extent.contentEnd <= bufferOffset_ + end_)
+   {
+      begin_ = static_cast<size_t>(extent.contentEnd - bufferOffset_);
+      return;
+   }
+
+   remaining_ -= extent.contentEnd - nextOffset_;
+   nextOffset_ = extent.contentEnd;
+
+   bufferOffset_ = extent.contentEnd;
+   begin_ = 0;
+   end_ = 0;
+}
+
+void XmlReader::parseText(E57XmlParser& handler, const char* p, const char* end, bool expandReferences)
+{
+   if (depth_ == 0 && fragmentIndex_ == nullptr)
+   {
+      if (skipSpace(p, end) != end)
+      {
+         error(skipSpace(p, end), "text outside the root element");
+      }
+      return;
+   }
+
+   if (p == end)
+   {
+      return;
+   }
+
+   /// Most text has nothing to expand or normalize, pass that on where it is
+   if ((!expandReferences || memchr(p, '&', end - p) == nullptr) && memchr(p, '\r', end - p) == nullptr)
+   {
+      handler.characters(p, end - p);
+      return;
+   }
+
+   decode(p, end, expandReferences, false, text_);
+   handler.characters(text_.data(), text_.length());
+}
+
+void XmlReader::decode(const char* p, const char* end, bool expandReferences, bool attributeValue, ustring& out)
+{
+   /// Expand references and normalize line ends, and whitespace too in an attribute value
+   const uint8_t* classes = charClasses();
+   const uint8_t special = attributeValue ? attributeSpecial : textSpecial;
+
+   out.clear();
+
+   while (p < end)
+   {
+      /// Copy a run of characters that stay as they are in one go
+      const char* run = p;
+      while (p < end && (classes[static_cast<uint8_t>(*p)] & special) == 0)
+      {
+         p++;
+      }
+      out.append(run, p);
+
+      if (p == end)
+      {
+         break;
+      }
+
+      const char c = *p;
+
+      if (c == '&' && expandReferences)
+      {
+         const char* semicolon = static_cast<const char*>(memchr(p, ';', end - p));
+         if (semicolon == nullptr)
+         {
+            error(p, "reference not terminated");
+         }
+
+         const ustring name(p + 1, semicolon);
+
+         if (name == "lt")
+         {
+            out += '<';
+         }
+         else if (name == "gt")
+         {
+            out += '>';
+         }
+         else if (name == "amp")
+         {
+            out += '&';
+         }
+         else if (name == "apos")
+         {
+            out += '\'';
+         }
+         else if (name == "quot")
+         {
+            out += '"';
+         }
+         else if (name.length() >= 2 && name[0] == '#')
+         {
+            const bool isHex = (name[1] == 'x');
+            const size_t first = isHex ? 2 : 1;
+
+            uint32_t value = 0;
+            for (size_t i = first; i < name.length(); i++)
+            {
+               const char digit = name[i];
+               uint32_t digitValue = 16;
+
+               if (digit >= '0' && digit <= '9')
+               {
+                  digitValue = digit - '0';
+               }
+               else if (isHex && digit >= 'a' && digit <= 'f')
+               {
+                  digitValue = digit - 'a' + 10;
+               }
+               else if (isHex && digit >= 'A' && digit <= 'F')
+               {
+                  digitValue = digit - 'A' + 10;
+               }
+
+               if (digitValue >= (isHex ? 16u : 10u) || value > 0x10FFFF)
+               {
+                  error(p, "bad character reference &" + name + ";");
+               }
+               value = value * (isHex ? 16 : 10) + digitValue;
+            }
+
+            if (first == name.length() || value == 0 || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF))
+            {
+               error(p, "bad character reference &" + name + ";");
+            }
+
+            appendUtf8(value, out);
+         }
+         else
+         {
+            error(p, "undefined entity &" + name + ";");
+         }
+
+         p = semicolon + 1;
+      }
+      else if (c == '\r')
+      {
+         /// A CR LF pair or lone CR is a line feed
+         out += attributeValue ? ' ' : '\n';
+         p++;
+         if (p < end && *p == '\n')
+         {
+            p++;
+         }
+      }
+      else if (attributeValue && (c == '\n' || c == '\t'))
+      {
+         out += ' ';
+         p++;
+      }
+      else if (attributeValue && c == '<')
+      {
+         error(p, "'<' in attribute value");
+      }
+      else
+      {
+         out += c;
+         p++;
+      }
+   }
+}
+
+const ustring& XmlReader::resolvePrefix(const char* at, const ustring& prefix)
+{
+   for (auto binding = bindings_.rbegin(); binding != bindings_.rend(); ++binding)
+   {
+      if (binding->prefix == prefix)
+      {
+         return binding->uri;
+      }
+   }
+
+   if (prefix.empty())
+   {
+      return noUri;
+   }
+
+   if (prefix == "xml")
+   {
+      return xmlUri;
+   }
+
+   error(at, "namespace prefix " + prefix + " not declared");
+}
+
+void XmlReader::error(const char* at, const ustring& message)
+{
+   /// at is in buffer_, or null for the end of the section
+   const char* first = buffer_.data();
+   const char* last = (at == nullptr) ? buffer_.data() + end_ : at;
+
+   uint64_t line = 1;
+   uint64_t column = 1;
+
+   /// Lines aren't counted while parsing, so read what came before buffer_ again to find where at is
+   vector<char> before(readChunkSize);
+   for (uint64_t offset = sectionStart_; offset < bufferOffset_; offset += before.size())
+   {
+      const size_t length = static_cast<size_t>(min<uint64_t>(before.size(), bufferOffset_ - offset));
+      cf_->readAt(offset, before.data(), length);
+      countLines(before.data(), before.data() + length, line, column);
+   }
+
+   countLines(first, last, line, column);
+
+   throw E57_EXCEPTION2(E57_ERROR_XML_PARSER,
+                        "xmlLine=" + toString(line)
+                        + " xmlColumn=" + toString(column)
+                        + " parserMessage=" + message);
+}
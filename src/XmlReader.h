@@ -0,0 +1,146 @@
+#ifndef XMLREADER_H
+#define XMLREADER_H
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <vector>
+
+#include "E57XmlParser.h"
+
+namespace e57
+{
+   class CheckedFile;
+
+   /// Namespace prefix in scope, empty for the default namespace
+   struct XmlBinding
+   {
+         ustring     prefix;
+         ustring     uri;
+   };
+
+   /// Where the content of an element with child elements is, between the end of its start tag and its end tag
+   struct XmlExtent
+   {
+         uint64_t    contentStart = 0;    // logical offsets in the file
+         uint64_t    contentEnd = 0;
+         size_t      descendants = 0;     // number of extents inside this one, which come right after it
+   };
+
+   /// Elements whose content was skipped over by a lazy parse, to be parsed on their own later
+   struct XmlIndex
+   {
+         uint64_t    sectionStart = 0;         // logical offset of the XML section
+         std::vector<XmlExtent>  extents;      // in document order
+         std::vector<XmlBinding> namespaces;   // in scope at the first extent
+   };
+
+   /// Non-validating SAX parser for the XML section of an E57 file, used instead of Xerces-C if built with
+   /// E57_BUILTIN_XML_PARSER, and for lazy reading in any build.  Reads the section straight from the logical pages of
+   /// the file a chunk at a time, and passes elements and text to E57XmlParser in UTF-8 as they are in the file,
+   /// without transcoding.
+   /// Handles namespaces, character and predefined entity references, CDATA sections, comments and processing
+   /// instructions.  Only UTF-8 is accepted.  A document type declaration is skipped, entities it declares are not.
+   ///
+   /// Given an XmlIndex, the handler may take the content of an element to parse later (see
+   /// E57XmlParser::deferChildren()).  The content is then only skimmed for the extents of the elements in it, which
+   /// are checked to nest properly but are otherwise not looked at until parsed.  Namespace declarations below the
+   /// element taken first are not seen by content parsed later.
+   class XmlReader
+   {
+      public:
+         XmlReader(CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength);
+
+         /// Reader of the whole section that fills in index with the content the handler takes
+         XmlReader(CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength, XmlIndex& index);
+
+         /// Reader of the content of extent of an index filled in by the reader above
+         XmlReader(CheckedFile* cf, const XmlIndex& index, size_t extent);
+
+         /// Parse the whole section, or the content of the extent, passing everything in it to handler.
+         /// Throws E57_ERROR_XML_PARSER if the XML is not well formed.
+         void        parse(E57XmlParser& handler);
+
+      private:
+         XmlReader(const XmlReader&) = delete;
+         XmlReader& operator=(const XmlReader&) = delete;
+
+         struct OpenElement
+         {
+               ustring     qName;
+               ustring     localName;
+               ustring     uri;
+               size_t      bindingCount = 0;    // size of bindings_ before the namespace declarations of the element
+         };
+
+         struct SkimmedElement
+         {
+               ustring     qName;
+               size_t      extent = 0;          // in newIndex_, npos until a child element is found
+               uint64_t    contentStart = 0;
+         };
+
+         bool        readMore();
+         size_t      find(size_t from, const char* terminator);
+         size_t      tagLength(bool allowBrackets);
+
+         void        parseDeclaration(const char* p, const char* end);
+         bool        parseStartTag(E57XmlParser& handler, const char* p, const char* end);
+         void        parseEndTag(E57XmlParser& handler, const char* p, const char* end);
+         void        parseText(E57XmlParser& handler, const char* p, const char* end, bool expandReferences);
+         void        decode(const char* p, const char* end, bool expandReferences, bool attributeValue, ustring& out);
+         void        endElement(E57XmlParser& handler);
+         void        offerContent(E57XmlParser& handler);
+         void        skim(size_t extent);
+         void        skipTo(const XmlExtent& extent);
+         const ustring& resolvePrefix(const char* at, const ustring& prefix);
+
+         [[noreturn]] void error(const char* at, const ustring& message);
+
+         CheckedFile*      cf_;
+         uint64_t          sectionStart_;       // logical offset of the XML section, lines are counted from there
+         uint64_t          nextOffset_;         // logical offset of the first byte not read yet
+         uint64_t          remaining_;          // bytes of the section not read yet
+
+         std::vector<char> buffer_;
+         uint64_t          bufferOffset_;       // logical offset of buffer_[0]
+         size_t            begin_ = 0;          // first byte in buffer_ not parsed yet
+         size_t            end_ = 0;            // end of the bytes read into buffer_
+
+         XmlIndex*         newIndex_ = nullptr; // to note skipped content in, if parsing the whole section lazily
+         const XmlIndex*   fragmentIndex_ = nullptr;  // if parsing the content of an extent, the index it is in
+         size_t            nextExtent_ = 0;     // next extent in fragmentIndex_ to come
+         std::vector<SkimmedElement> skimmed_;  // elements started but not ended in skim(), reused
+
+         std::vector<OpenElement> open_;        // elements started but not ended, reused to save allocations
+         size_t            depth_ = 0;          // number of entries in use in open_
+         bool              rootSeen_ = false;
+         std::vector<XmlBinding> bindings_;     // namespace prefixes in scope, innermost last
+         XmlAttributes     attributes_;         // attributes of the element being started
+         ustring           text_;               // text with references expanded
+   };
+}
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Closing or cancelling an ImageFile while a reader that prefetches packets is still open.
+/// The prefetch thread used to go on reading through the deleted file.
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "E57Format.h"
+
+using namespace e57;
+using namespace std;
+
+namespace
+{
+   const char*    fileName = "testCloseWithOpenReader.e57";
+   const int64_t  pointCount = 1000000;
+   const size_t   blockSize = 10000;
+
+   void writePoints()
+   {
+      ImageFile imf( fileName, "w" );
+
+      StructureNode proto( imf );
+      proto.set( "cartesianX", FloatNode(imf, 0.0, E57_DOUBLE) );
+      proto.set( "cartesianY", FloatNode(imf, 0.0, E57_DOUBLE) );
+      proto.set( "cartesianZ", FloatNode(imf, 0.0, E57_DOUBLE) );
+
+      VectorNode codecs( imf, true );
+      CompressedVectorNode points( imf, proto, codecs );
+      imf.root().set( "points", points );
+
+      vector<double> x( blockSize ), y( blockSize ), z( blockSize );
+      vector<SourceDestBuffer> sbufs;
+      sbufs.emplace_back( imf, "cartesianX", x.data(), blockSize, true );
+      sbufs.emplace_back( imf, "cartesianY", y.data(), blockSize, true );
+      sbufs.emplace_back( imf, "cartesianZ", z.data(), blockSize, true );
+
+      CompressedVectorWriter writer = points.writer( sbufs );
+      for ( int64_t start = 0; start < pointCount; start += blockSize )
+      {
+         for ( size_t i = 0; i < blockSize; i++ )
+         {
+            x[i] = static_cast<double>( start + i );
+            y[i] = 2.0 * x[i];
+            z[i] = 3.0 * x[i];
+         }
+         writer.write( blockSize );
+      }
+      writer.close();
+
+      imf.close();
+   }
+
+   /// Read one block with prefetching on, then end the ImageFile before the reader
+   void readThenEnd( bool cancel )
+   {
+      ImageFile imf( fileName, "r" );
+      imf.setPacketCacheSize( 256 );
+      imf.setPacketPrefetchCount( 200 );
+
+      CompressedVectorNode points( imf.root().get("points") );
+
+      vector<double> x( blockSize );
+      vector<SourceDestBuffer> dbufs;
+      dbufs.emplace_back( imf, "cartesianX", x.data(), blockSize, true );
+
+      CompressedVectorReader reader = points.reader( dbufs );
+      if ( reader.read() != blockSize || x[blockSize-1] != blockSize - 1 )
+      {
+         throw runtime_error( "wrong points read" );
+      }
+
+      if ( cancel )
+      {
+         imf.cancel();
+      }
+      else
+      {
+         imf.close();
+      }
+
+      reader.close();
+   }
+}
+
+int main()
+{
+   try
+   {
+      writePoints();
+
+      /// Depends on where the prefetch thread is at the time, so have a few goes
+      for ( int i = 0; i < 10; i++ )
+      {
+         readThenEnd( false );
+         readThenEnd( true );
+      }
+   }
+   catch ( E57Exception& ex )
+   {
+      ex.report( __FILE__, __LINE__, static_cast<const char *>(__FUNCTION__) );
+      return EXIT_FAILURE;
+   }
+   catch ( exception& ex )
+   {
+      cerr << "Got an std::exception, what=" << ex.what() << endl;
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}